@@ -0,0 +1,312 @@
+// FIFOScan.h
+#ifndef FIFOSCAN_H
+#define FIFOSCAN_H
+
+#include "Scheduler.h"
+#include "Simulator.h"
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FIFO_SCAN_X86 1
+#endif
+
+// Closed-form FIFO for processes that are a single CPU burst. Such a process runs once, from
+// when the core is free and it has arrived until its burst (and the context switch before it)
+// is done, so the completion times are the max-plus prefix scan
+//     completion[i] = max(completion[i - 1], arrival[i]) + context_switch + burst[i]
+// and every metric follows from them. The scan goes over the flat arrays with SIMD: within a
+// vector, completion[j] = Q[j] + max(time, max over k <= j of (arrival[k] - Q[k] + service[k]))
+// where Q is the prefix sum of the services, so it is a prefix sum and a prefix max. Long
+// runs are split into blocks scanned by separate threads: a block maps the time the core
+// becomes free for it to max(time + its total service, its completion when started at once),
+// so the blocks are summarized in parallel, chained in order and then scanned for real.
+// The metrics are exactly those of a Simulator<FIFOPolicy, UniCore> run.
+
+// Processes scanned per call of a kernel, sized so its outputs stay in L1
+const int FIFO_SCAN_CHUNK = 2048;
+// Fewest processes worth giving to a thread of their own
+const size_t FIFO_SCAN_MIN_BLOCK = 1 << 16;
+
+// Whether each of `n` processes owns exactly one burst, given their burst offsets. Comparing
+// totals is not enough: a process without bursts and one with a CPU and an I/O burst add up
+// to two single bursts.
+inline bool singleBursts(const size_t *burst_offset, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (burst_offset[i + 1] - burst_offset[i] != 1) return false;
+    }
+    return true;
+}
+
+// Whether every time the scan computes fits its 32-bit lanes. No process completes later than
+// the latest arrival plus the services of all processes, which is summed in 64 bits.
+inline bool scanFits(const int *arrival, const int *burst, size_t n, int context_switch) {
+    long long latest = 0, services = 0;
+    for (size_t i = 0; i < n; i++) {
+        latest = max(latest, (long long)arrival[i]);
+        services += (long long)burst[i] + context_switch;
+    }
+    return latest + services <= INT_MAX;
+}
+
+// Whether a workload can be run by scanFIFO rather than simulated: every process is one CPU
+// burst, no time overflows the scan and the run is not traced
+inline bool fifoScanApplies(const Workload &workload, const SimConfig &config) {
+    return !config.trace && singleBursts(workload.burst_offset.data(), workload.size()) &&
+           scanFits(workload.arrival_time.data(), workload.bursts.data(), workload.size(),
+                    config.switching.context_switch);
+}
+
+// Sums and maxima of a scanned chunk
+struct ScanTotals {
+    long long turnaround = 0, waiting = 0, service = 0;
+    int max_turnaround = 0, max_waiting = 0;
+};
+
+// Kernels: scan `n` processes starting with the core free at `time`, write their turnaround
+// and waiting times, add to the totals and return the completion of the last one.
+
+inline int scanChunkScalar(const int *arrival, const int *burst, int n, int cost, int time,
+                           int *turnaround, int *waiting, ScanTotals &totals) {
+    for (int j = 0; j < n; j++) {
+        int service = burst[j] + cost;
+        int start = max(time, arrival[j]);
+        time = start + service;
+        turnaround[j] = time - arrival[j];
+        waiting[j] = start - arrival[j];
+        totals.turnaround += turnaround[j];
+        totals.waiting += waiting[j];
+        totals.service += service;
+        totals.max_turnaround = max(totals.max_turnaround, turnaround[j]);
+        totals.max_waiting = max(totals.max_waiting, waiting[j]);
+    }
+    return time;
+}
+
+#ifdef FIFO_SCAN_X86
+
+__attribute__((target("avx2"))) inline long long sumLanesAVX2(__m256i sums) {
+    __m128i pair = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    return _mm_cvtsi128_si64(pair) + _mm_extract_epi64(pair, 1);
+}
+
+__attribute__((target("avx2"))) inline int maxLanesAVX2(__m256i maxima) {
+    __m128i four = _mm_max_epi32(_mm256_castsi256_si128(maxima), _mm256_extracti128_si256(maxima, 1));
+    __m128i two = _mm_max_epi32(four, _mm_shuffle_epi32(four, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtsi128_si32(_mm_max_epi32(two, _mm_shuffle_epi32(two, _MM_SHUFFLE(2, 3, 0, 1))));
+}
+
+// Adds the eight 32-bit lanes of `values` to four 64-bit sums
+__attribute__((target("avx2"))) inline __m256i addWideAVX2(__m256i sums, __m256i values) {
+    sums = _mm256_add_epi64(sums, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(values)));
+    return _mm256_add_epi64(sums, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(values, 1)));
+}
+
+__attribute__((target("avx2"))) inline int scanChunkAVX2(const int *arrival, const int *burst, int n, int cost, int time,
+                                                          int *turnaround, int *waiting, ScanTotals &totals) {
+    // Lane j of a vector permuted by these holds lane j - 1, j - 2 or j - 4, clamped to lane 0
+    const __m256i by1 = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+    const __m256i by2 = _mm256_setr_epi32(0, 0, 0, 1, 2, 3, 4, 5);
+    const __m256i by4 = _mm256_setr_epi32(0, 0, 0, 0, 0, 1, 2, 3);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i costs = _mm256_set1_epi32(cost);
+    __m256i turnaround_sum = zero, waiting_sum = zero, service_sum = zero;
+    __m256i turnaround_max = zero, waiting_max = zero;
+
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m256i arrivals = _mm256_loadu_si256((const __m256i *)(arrival + j));
+        __m256i service = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(burst + j)), costs);
+        // Prefix sum of the services; the lanes shifted in below lane 0 must add nothing
+        __m256i done = service;
+        done = _mm256_add_epi32(done, _mm256_blend_epi32(_mm256_permutevar8x32_epi32(done, by1), zero, 0x01));
+        done = _mm256_add_epi32(done, _mm256_blend_epi32(_mm256_permutevar8x32_epi32(done, by2), zero, 0x03));
+        done = _mm256_add_epi32(done, _mm256_blend_epi32(_mm256_permutevar8x32_epi32(done, by4), zero, 0x0F));
+        // Prefix max of the latest start each arrival forces; repeating lane 0 is harmless
+        __m256i latest = _mm256_sub_epi32(arrivals, _mm256_sub_epi32(done, service));
+        latest = _mm256_max_epi32(latest, _mm256_permutevar8x32_epi32(latest, by1));
+        latest = _mm256_max_epi32(latest, _mm256_permutevar8x32_epi32(latest, by2));
+        latest = _mm256_max_epi32(latest, _mm256_permutevar8x32_epi32(latest, by4));
+        __m256i completion = _mm256_add_epi32(done, _mm256_max_epi32(latest, _mm256_set1_epi32(time)));
+        time = _mm256_extract_epi32(completion, 7);
+
+        __m256i turnarounds = _mm256_sub_epi32(completion, arrivals);
+        __m256i waits = _mm256_sub_epi32(turnarounds, service);
+        _mm256_storeu_si256((__m256i *)(turnaround + j), turnarounds);
+        _mm256_storeu_si256((__m256i *)(waiting + j), waits);
+        turnaround_sum = addWideAVX2(turnaround_sum, turnarounds);
+        waiting_sum = addWideAVX2(waiting_sum, waits);
+        service_sum = addWideAVX2(service_sum, service);
+        turnaround_max = _mm256_max_epi32(turnaround_max, turnarounds);
+        waiting_max = _mm256_max_epi32(waiting_max, waits);
+    }
+    totals.turnaround += sumLanesAVX2(turnaround_sum);
+    totals.waiting += sumLanesAVX2(waiting_sum);
+    totals.service += sumLanesAVX2(service_sum);
+    totals.max_turnaround = max(totals.max_turnaround, maxLanesAVX2(turnaround_max));
+    totals.max_waiting = max(totals.max_waiting, maxLanesAVX2(waiting_max));
+    return scanChunkScalar(arrival + j, burst + j, n - j, cost, time, turnaround + j, waiting + j, totals);
+}
+
+__attribute__((target("sse4.1"))) inline __m128i addWideSSE(__m128i sums, __m128i values) {
+    sums = _mm_add_epi64(sums, _mm_cvtepi32_epi64(values));
+    return _mm_add_epi64(sums, _mm_cvtepi32_epi64(_mm_unpackhi_epi64(values, values)));
+}
+
+__attribute__((target("sse4.1"))) inline int scanChunkSSE(const int *arrival, const int *burst, int n, int cost, int time,
+                                                           int *turnaround, int *waiting, ScanTotals &totals) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i costs = _mm_set1_epi32(cost);
+    __m128i turnaround_sum = zero, waiting_sum = zero, service_sum = zero;
+    __m128i turnaround_max = zero, waiting_max = zero;
+
+    int j = 0;
+    for (; j + 4 <= n; j += 4) {
+        __m128i arrivals = _mm_loadu_si128((const __m128i *)(arrival + j));
+        __m128i service = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(burst + j)), costs);
+        __m128i done = service;
+        done = _mm_add_epi32(done, _mm_slli_si128(done, 4));
+        done = _mm_add_epi32(done, _mm_slli_si128(done, 8));
+        __m128i latest = _mm_sub_epi32(arrivals, _mm_sub_epi32(done, service));
+        latest = _mm_max_epi32(latest, _mm_shuffle_epi32(latest, _MM_SHUFFLE(2, 1, 0, 0)));
+        latest = _mm_max_epi32(latest, _mm_shuffle_epi32(latest, _MM_SHUFFLE(1, 0, 0, 0)));
+        __m128i completion = _mm_add_epi32(done, _mm_max_epi32(latest, _mm_set1_epi32(time)));
+        time = _mm_extract_epi32(completion, 3);
+
+        __m128i turnarounds = _mm_sub_epi32(completion, arrivals);
+        __m128i waits = _mm_sub_epi32(turnarounds, service);
+        _mm_storeu_si128((__m128i *)(turnaround + j), turnarounds);
+        _mm_storeu_si128((__m128i *)(waiting + j), waits);
+        turnaround_sum = addWideSSE(turnaround_sum, turnarounds);
+        waiting_sum = addWideSSE(waiting_sum, waits);
+        service_sum = addWideSSE(service_sum, service);
+        turnaround_max = _mm_max_epi32(turnaround_max, turnarounds);
+        waiting_max = _mm_max_epi32(waiting_max, waits);
+    }
+    long long sums[6];
+    _mm_storeu_si128((__m128i *)sums, turnaround_sum);
+    _mm_storeu_si128((__m128i *)(sums + 2), waiting_sum);
+    _mm_storeu_si128((__m128i *)(sums + 4), service_sum);
+    int maxima[8];
+    _mm_storeu_si128((__m128i *)maxima, turnaround_max);
+    _mm_storeu_si128((__m128i *)(maxima + 4), waiting_max);
+    totals.turnaround += sums[0] + sums[1];
+    totals.waiting += sums[2] + sums[3];
+    totals.service += sums[4] + sums[5];
+    totals.max_turnaround = max({totals.max_turnaround, maxima[0], maxima[1], maxima[2], maxima[3]});
+    totals.max_waiting = max({totals.max_waiting, maxima[4], maxima[5], maxima[6], maxima[7]});
+    return scanChunkScalar(arrival + j, burst + j, n - j, cost, time, turnaround + j, waiting + j, totals);
+}
+
+#endif // FIFO_SCAN_X86
+
+typedef int (*ScanKernel)(const int *, const int *, int, int, int, int *, int *, ScanTotals &);
+
+// Widest kernel the CPU running the program supports
+inline ScanKernel scanKernel() {
+#ifdef FIFO_SCAN_X86
+    if (__builtin_cpu_supports("avx2")) return scanChunkAVX2;
+    if (__builtin_cpu_supports("sse4.1")) return scanChunkSSE;
+#endif
+    return scanChunkScalar;
+}
+
+struct FIFOScanResult {
+    RunMetrics metrics;
+    int last_completion = 0;   // Time the last process completed, 0 without processes
+    SimCounters counters;      // What the scan can tell: one pick per process, and its time
+};
+
+// Scans processes [begin, end) with the core free at `time` and returns when the last one
+// completes. With `metrics` the processes are recorded in it, otherwise only the totals are kept.
+inline int scanBlock(ScanKernel kernel, const int *arrival, const int *burst, const int *deadline, size_t begin, size_t end,
+                     int cost, int time, ScanTotals &totals, RunMetrics *metrics) {
+    int turnaround[FIFO_SCAN_CHUNK], waiting[FIFO_SCAN_CHUNK];
+    for (size_t first = begin; first < end; first += FIFO_SCAN_CHUNK) {
+        int n = (int)min<size_t>(FIFO_SCAN_CHUNK, end - first);
+        time = kernel(arrival + first, burst + first, n, cost, time, turnaround, waiting, totals);
+        if (!metrics) continue;
+        for (int j = 0; j < n; j++) {
+            metrics->turnaround.record(turnaround[j]);
+            metrics->waiting.record(waiting[j]);
+            metrics->response.record(waiting[j]);
+            if (deadline && deadline[first + j] != NO_DEADLINE) {
+                metrics->deadline_processes++;
+                if (arrival[first + j] + turnaround[j] > deadline[first + j]) metrics->deadline_misses++;
+            }
+        }
+    }
+    return time;
+}
+
+// Runs FIFO over `n` single-burst processes given as flat arrival-ordered arrays, which
+// scanFits; `deadline` may be null when no process has one. Uses up to `threads` threads.
+inline FIFOScanResult scanFIFO(const int *arrival, const int *burst, const int *deadline, size_t n, int context_switch,
+                               int threads = thread::hardware_concurrency()) {
+    long long scan_start = phaseClock();
+    ScanKernel kernel = scanKernel();
+    size_t blocks = max<size_t>(1, min<size_t>(max(threads, 1), n / FIFO_SCAN_MIN_BLOCK));
+    vector<size_t> bounds(blocks + 1);
+    for (size_t b = 0; b <= blocks; b++) bounds[b] = n * b / blocks;
+
+    vector<ScanTotals> totals(blocks);
+    vector<RunMetrics> metrics(blocks);
+    // Time the core becomes free for each block; before the first one it is free from the start
+    vector<int> start(blocks, INT_MIN);
+    auto parallel = [&](auto work) {
+        vector<thread> workers;
+        for (size_t b = 1; b < blocks; b++) workers.emplace_back(work, b);
+        work(0);
+        for (auto &worker : workers) worker.join();
+    };
+
+    if (blocks > 1) {
+        // Completion of every block when started at once, and its total service
+        vector<int> alone(blocks);
+        parallel([&](size_t b) {
+            ScanTotals block_totals;
+            alone[b] = scanBlock(kernel, arrival, burst, deadline, bounds[b], bounds[b + 1], context_switch, INT_MIN,
+                                 block_totals, nullptr);
+            totals[b].service = block_totals.service;
+        });
+        for (size_t b = 1; b < blocks; b++) {
+            start[b] = (int)max(start[b - 1] + totals[b - 1].service, (long long)alone[b - 1]);
+        }
+        for (ScanTotals &block_totals : totals) block_totals = ScanTotals();
+    }
+
+    vector<int> last(blocks);
+    parallel([&](size_t b) {
+        last[b] = scanBlock(kernel, arrival, burst, deadline, bounds[b], bounds[b + 1], context_switch, start[b], totals[b],
+                            &metrics[b]);
+    });
+
+    FIFOScanResult result;
+    for (size_t b = 0; b < blocks; b++) {
+        RunMetrics &block = metrics[b];
+        size_t count = bounds[b + 1] - bounds[b];
+        block.total_turnaround_time = totals[b].turnaround;
+        block.total_waiting_time = block.total_response_time = totals[b].waiting;
+        block.max_turnaround_time = totals[b].max_turnaround;
+        block.max_waiting_time = block.max_response_time = totals[b].max_waiting;
+        block.total_processes = count;
+        // Every process is dispatched once, each time by a context switch
+        block.context_switches = count;
+        block.overhead_time = (long long)count * context_switch;
+        result.metrics.merge(block);
+    }
+    result.last_completion = n > 0 ? last[blocks - 1] : 0;
+    result.counters.decisions = n;
+    result.counters.queue_operations = 2 * n;
+    result.counters.end_time = result.last_completion;
+    result.counters.loop_ns = phaseClock() - scan_start;
+    return result;
+}
+
+// Runs FIFO over a workload that fifoScanApplies to
+inline FIFOScanResult scanFIFO(const Workload &workload, const SimConfig &config) {
+    return scanFIFO(workload.arrival_time.data(), workload.bursts.data(), workload.deadline.data(), workload.size(),
+                    config.switching.context_switch);
+}
+
+#endif // FIFOSCAN_H
@@ -0,0 +1,223 @@
+// Generator.h
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include "Scheduler.h"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+// Processes are generated in blocks of this size, each from its own random stream, so the
+// output for a seed is the same whatever the number of threads
+const size_t GENERATOR_BLOCK_SIZE = 1 << 16;
+
+enum class ArrivalPattern {
+    Poisson,   // Exponential gaps at a constant rate
+    Bursty     // Clusters of closely spaced arrivals with the same long-run rate
+};
+
+enum class BurstDistribution {
+    Pareto,    // Heavy tail: cpu_min / U^(1 / pareto_alpha)
+    Lognormal  // exp(N(lognormal_mu, lognormal_sigma))
+};
+
+struct GeneratorConfig {
+    uint64_t seed = 1;
+    long long processes = 1000;
+    ArrivalPattern arrivals = ArrivalPattern::Poisson;
+    double arrival_rate = 0.1;        // Mean arrivals per time unit
+    double cluster_size = 8;          // Mean arrivals per cluster for bursty arrivals
+    BurstDistribution cpu = BurstDistribution::Pareto;
+    double cpu_min = 5;               // Pareto scale
+    double pareto_alpha = 1.5;
+    double lognormal_mu = 2;
+    double lognormal_sigma = 1;
+    int cpu_max = 100000;             // CPU bursts are clamped to [1, cpu_max]
+    double cpu_bursts = 1;            // Mean CPU bursts per process; 1 means CPU-bound only
+    double io_mean = 20;              // Mean I/O burst
+    int nice_spread = 0;              // Nice values are uniform in [-nice_spread, nice_spread]
+    double deadline_slack = 0;        // Deadline is arrival + slack * total CPU time; 0 for no deadlines
+};
+
+// xoshiro256** seeded through splitmix64. Hand-rolled rather than <random> so a seed gives
+// the same workload with every standard library.
+struct GeneratorRandom {
+    uint64_t state[4];
+
+    GeneratorRandom(uint64_t seed, uint64_t stream) {
+        uint64_t x = seed ^ (stream * 0x9e3779b97f4a7c15ULL);
+        for (auto &word : state) {
+            x += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    uint64_t next() {
+        uint64_t result = rotl(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    // Uniform in (0, 1]
+    double uniform() { return ((next() >> 11) + 1) * (1.0 / 9007199254740992.0); }
+    double exponential(double mean) { return -mean * log(uniform()); }
+    double normal() { return sqrt(-2 * log(uniform())) * cos(6.283185307179586 * uniform()); }
+    int below(int bound) { return (int)((next() >> 33) % (uint64_t)bound); }
+};
+
+// One block of generated processes. Arrival times are kept relative to the start of the
+// block until the blocks before it are known, and deadlines relative to the arrival.
+struct GeneratedBlock {
+    Workload workload;
+    vector<double> arrival;    // Relative arrival of each process
+    double span = 0;           // Relative time at which the next block starts
+
+    // Fixes the absolute arrival times once the start of the block is known; returns false if
+    // they do not fit in an int
+    bool place(double start) {
+        for (size_t i = 0; i < arrival.size(); i++) {
+            double time = floor(start + arrival[i]);
+            if (time > INT_MAX) return false;
+            workload.arrival_time[i] = (int)time;
+            // Deadlines past the end of time are clamped rather than dropped
+            int &deadline = workload.deadline[i];
+            if (deadline != NO_DEADLINE) deadline = (int)min<long long>((long long)deadline + (int)time, NO_DEADLINE - 1);
+        }
+        return true;
+    }
+};
+
+inline int clampBurst(double value, int max_value) {
+    if (!(value >= 1)) return 1;
+    return value >= max_value ? max_value : (int)value;
+}
+
+// Generates block `block` of the workload: processes block * GENERATOR_BLOCK_SIZE onwards
+inline void generateBlock(const GeneratorConfig &config, size_t block, GeneratedBlock &out) {
+    GeneratorRandom random(config.seed, block);
+    long long first = (long long)block * GENERATOR_BLOCK_SIZE;
+    long long count = min<long long>(GENERATOR_BLOCK_SIZE, config.processes - first);
+
+    // Bursty arrivals keep the long-run rate: gaps inside a cluster are a tenth of the mean gap
+    // and the gap before a cluster makes up the rest
+    double mean_gap = 1 / config.arrival_rate;
+    double cluster_gap = mean_gap * (config.cluster_size - 0.1 * (config.cluster_size - 1));
+    double next_cluster_probability = 1 / max(config.cluster_size, 1.0);
+
+    // Geometric number of CPU bursts with mean cpu_bursts
+    double last_burst_probability = 1 / max(config.cpu_bursts, 1.0);
+
+    double time = 0;
+    out.arrival.clear();
+    for (long long i = 0; i < count; i++) {
+        if (config.arrivals == ArrivalPattern::Poisson) {
+            time += random.exponential(mean_gap);
+        } else if (random.uniform() <= next_cluster_probability) {
+            time += random.exponential(cluster_gap);
+        } else {
+            time += random.exponential(0.1 * mean_gap);
+        }
+        out.arrival.push_back(time);
+
+        while (true) {
+            double cpu = config.cpu == BurstDistribution::Pareto
+                ? config.cpu_min / pow(random.uniform(), 1 / config.pareto_alpha)
+                : exp(config.lognormal_mu + config.lognormal_sigma * random.normal());
+            out.workload.bursts.push_back(clampBurst(cpu, config.cpu_max));
+            if (random.uniform() <= last_burst_probability) break;
+            out.workload.bursts.push_back(clampBurst(random.exponential(config.io_mean), INT_MAX));
+        }
+
+        int nice = config.nice_spread > 0 ? random.below(2 * config.nice_spread + 1) - config.nice_spread : 0;
+        int deadline = NO_DEADLINE;
+        if (config.deadline_slack > 0) {
+            long long cpu_time = 0;
+            for (size_t b = out.workload.burst_offset.back(); b < out.workload.bursts.size(); b += 2) cpu_time += out.workload.bursts[b];
+            deadline = (int)min(ceil(config.deadline_slack * cpu_time), (double)(NO_DEADLINE - 1));
+        }
+        out.workload.addProcess(first + i, 0, max(-20, min(19, nice)), deadline);
+    }
+    out.span = time;
+}
+
+// Generates blocks [begin, end) on up to `threads` threads and places their arrivals after
+// `start`, which is advanced past the last block. Returns false if an arrival overflows.
+inline bool generateBlocks(const GeneratorConfig &config, size_t begin, size_t end, unsigned threads,
+                           vector<GeneratedBlock> &blocks, double &start) {
+    blocks.assign(end - begin, GeneratedBlock());
+    threads = min<size_t>(threads, end - begin);
+    vector<thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (size_t b = begin + t; b < end; b += threads) generateBlock(config, b, blocks[b - begin]);
+        });
+    }
+    for (auto &worker : workers) worker.join();
+
+    // Block start times are summed in block order so they never depend on the thread count
+    for (auto &block : blocks) {
+        if (!block.place(start)) return false;
+        start += block.span;
+    }
+    return true;
+}
+
+inline size_t generatorBlockCount(const GeneratorConfig &config) {
+    return (config.processes + GENERATOR_BLOCK_SIZE - 1) / GENERATOR_BLOCK_SIZE;
+}
+
+// Generates the whole workload in memory, already sorted by arrival. Returns false if the
+// arrivals do not fit in an int.
+inline bool generateWorkload(const GeneratorConfig &config, Workload &workload, unsigned threads) {
+    vector<GeneratedBlock> blocks;
+    double start = 0;
+    if (!generateBlocks(config, 0, generatorBlockCount(config), max(1u, threads), blocks, start)) return false;
+
+    workload = Workload();
+    for (auto &block : blocks) {
+        workload.append(block.workload, 0);
+        block = GeneratedBlock();
+    }
+    return true;
+}
+
+// Formats processes in the text workload format: arrival, bursts, -1, then a nice value when
+// it is not 0 or a deadline follows, and the deadline if there is one
+inline void formatWorkloadText(const Workload &workload, string &out) {
+    char number[16];
+    auto put = [&](int value, char separator) {
+        char *end = to_chars(number, number + sizeof(number), value).ptr;
+        *end++ = separator;
+        out.append(number, end);
+    };
+
+    for (size_t i = 0; i < workload.size(); i++) {
+        put(workload.arrival_time[i], ' ');
+        for (size_t b = workload.burst_offset[i]; b < workload.burst_offset[i + 1]; b++) put(workload.bursts[b], ' ');
+        if (workload.deadline[i] != NO_DEADLINE) {
+            out.append("-1 ");
+            put(workload.nice[i], ' ');
+            put(workload.deadline[i], '\n');
+        } else if (workload.nice[i] != 0) {
+            out.append("-1 ");
+            put(workload.nice[i], '\n');
+        } else {
+            out.append("-1\n");
+        }
+    }
+}
+
+#endif // GENERATOR_H
@@ -0,0 +1,15 @@
+#include "Memory.h"
+#include <cstdlib>
+#include <new>
+
+// Replacements of the global allocation functions that count into thread_allocations; the
+// array and nothrow forms forward to them. They live in a translation unit of their own so
+// the header can be included anywhere, and only the programs link them.
+void *operator new(size_t size) {
+    thread_allocations++;
+    if (void *memory = malloc(size > 0 ? size : 1)) return memory;
+    throw bad_alloc();
+}
+
+void operator delete(void *memory) noexcept { free(memory); }
+void operator delete(void *memory, size_t) noexcept { free(memory); }
@@ -0,0 +1,13 @@
+// Memory.h
+#ifndef MEMORY_H
+#define MEMORY_H
+
+using namespace std;
+
+// Heap allocations made by the current thread so far. Memory.cpp replaces the global operator
+// new to count them, so the difference around a piece of code shows whether it allocated.
+// Only the programs link Memory.cpp; anything else that includes the simulator keeps its own
+// allocator and counts no allocations.
+inline thread_local long long thread_allocations = 0;
+
+#endif // MEMORY_H
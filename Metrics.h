@@ -0,0 +1,250 @@
+// Metrics.h
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "Scheduler.h"
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+
+// Log-bucketed latency histogram in the style of HdrHistogram. Values below 64 get a bucket
+// each; above that every power of two is split into 32 buckets, so a bucket is at most about
+// 3% wide relative to its values. The buckets are a fixed array covering every non-negative
+// time, so recording is a few shifts and an increment and never allocates.
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int BUCKETS = (63 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    void record(long long value) {
+        if (value < 0) value = 0;
+        counts[bucketOf(value)]++;
+        count++;
+        if (value > max_value) max_value = value;
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (int i = 0; i < BUCKETS; i++) counts[i] += other.counts[i];
+        count += other.count;
+        max_value = max(max_value, other.max_value);
+    }
+
+    // Smallest bucket bound that at least `percent` percent of the values are at or below,
+    // capped at the largest value recorded
+    long long percentile(double percent) const {
+        if (count == 0) return 0;
+        uint64_t rank = (uint64_t)ceil(percent / 100 * count);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) return min(upperBound(i), max_value);
+        }
+        return max_value;
+    }
+
+private:
+    uint64_t counts[BUCKETS] = {};
+    uint64_t count = 0;
+    long long max_value = 0;
+
+    static int bucketOf(long long value) {
+        if (value < 2 * SUB_BUCKETS) return value;
+        int shift = (63 - __builtin_clzll(value)) - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS + (int)(value >> shift) - SUB_BUCKETS;
+    }
+
+    // Largest value that falls into bucket `index`; the last bucket ends at LLONG_MAX
+    static long long upperBound(int index) {
+        if (index < 2 * SUB_BUCKETS) return index;
+        int shift = index / SUB_BUCKETS - 1;
+        unsigned long long sub_bucket = index % SUB_BUCKETS + SUB_BUCKETS;
+        return (long long)(((sub_bucket + 1) << shift) - 1);
+    }
+};
+
+// Metrics of the processes that completed in a run or on one processor, and of the switching
+// between them. Times and totals are 64-bit like the simulated clock, so long traces cannot
+// overflow them, and metrics of several processors merge exactly.
+struct RunMetrics {
+    long long total_turnaround_time = 0, total_waiting_time = 0, total_response_time = 0;
+    long long max_turnaround_time = 0, max_waiting_time = 0, max_response_time = 0;
+    long long total_processes = 0;
+    long long deadline_processes = 0, deadline_misses = 0;   // Processes with a deadline, and those that finished after it
+    long long context_switches = 0, migrations = 0;   // Times a core changed process, and those where it came from another core
+    long long overhead_time = 0;                      // CPU time lost to switching, see SwitchCosts
+    LatencyHistogram turnaround, waiting, response;
+
+    void record(const Process &process) {
+        long long response_time = process.first_run_time - process.arrival_time;
+        total_turnaround_time += process.turnaround_time;
+        total_waiting_time += process.waiting_time;
+        total_response_time += response_time;
+        if (process.turnaround_time > max_turnaround_time) max_turnaround_time = process.turnaround_time;
+        if (process.waiting_time > max_waiting_time) max_waiting_time = process.waiting_time;
+        if (response_time > max_response_time) max_response_time = response_time;
+        turnaround.record(process.turnaround_time);
+        waiting.record(process.waiting_time);
+        response.record(response_time);
+        total_processes++;
+        if (process.deadline != NO_DEADLINE) {
+            deadline_processes++;
+            if (process.completion_time > process.deadline) deadline_misses++;
+        }
+    }
+
+    void merge(const RunMetrics &other) {
+        total_turnaround_time += other.total_turnaround_time;
+        total_waiting_time += other.total_waiting_time;
+        total_response_time += other.total_response_time;
+        max_turnaround_time = max(max_turnaround_time, other.max_turnaround_time);
+        max_waiting_time = max(max_waiting_time, other.max_waiting_time);
+        max_response_time = max(max_response_time, other.max_response_time);
+        turnaround.merge(other.turnaround);
+        waiting.merge(other.waiting);
+        response.merge(other.response);
+        total_processes += other.total_processes;
+        deadline_processes += other.deadline_processes;
+        deadline_misses += other.deadline_misses;
+        context_switches += other.context_switches;
+        migrations += other.migrations;
+        overhead_time += other.overhead_time;
+    }
+};
+
+// Prints the p50/p90/p99/p99.9 lines of a run, each line starting with `prefix`
+inline void printPercentiles(const string &prefix, const RunMetrics &metrics) {
+    auto line = [&](const char *name, const LatencyHistogram &histogram) {
+        cout << prefix << name << " Time p50/p90/p99/p99.9: " << histogram.percentile(50) << " / "
+             << histogram.percentile(90) << " / " << histogram.percentile(99) << " / "
+             << histogram.percentile(99.9) << "\n";
+    };
+    line("Turnaround", metrics.turnaround);
+    line("Waiting", metrics.waiting);
+    line("Response", metrics.response);
+}
+
+// Prints the metrics of a whole run, each line starting with the algorithm name.
+// `seconds` is the wall-clock time the simulation took.
+inline void printRunMetrics(const string &name, const RunMetrics &metrics, double seconds) {
+    long long n = metrics.total_processes;
+    cout << name << " Average Turnaround Time: " << (double)metrics.total_turnaround_time / n << "\n";
+    cout << name << " Max Turnaround Time: " << metrics.max_turnaround_time << "\n";
+    cout << name << " Average Waiting Time: " << (double)metrics.total_waiting_time / n << "\n";
+    cout << name << " Max Waiting Time: " << metrics.max_waiting_time << "\n";
+    printPercentiles(name + " ", metrics);
+    if (metrics.deadline_processes > 0) {
+        cout << name << " Deadline Misses: " << metrics.deadline_misses << " of " << metrics.deadline_processes << "\n";
+    }
+    if (metrics.overhead_time > 0) {
+        cout << name << " Context Switches: " << metrics.context_switches << " (" << metrics.migrations
+             << " migrations), Switching Overhead: " << metrics.overhead_time << "\n";
+    }
+    cout << name << " Throughput: " << (double)n / seconds << " processes per second" << "\n";
+    cout << name << " Simulator Run Time: " << seconds << " seconds" << "\n";
+}
+
+// Pending window output written in one go once it grows past this
+const size_t WINDOW_BUFFER_BYTES = 1 << 16;
+// Longest window output waits to be written while the input is idle, in milliseconds
+const int WINDOW_IDLE_FLUSH_MS = 100;
+
+// Metrics of a live run reported window by window, every `interval` simulated time units or
+// every `wall_interval_ms` milliseconds of wall-clock time. A window counts the processes that
+// completed in it, their p99 waiting time and the number of ready processes at its end. The
+// simulator reports every completion and every step in time; lines are batched in a buffer
+// that is written when it fills up, when the input goes idle and at the end of the run.
+class WindowedMetrics {
+public:
+    WindowedMetrics(int interval, int wall_interval_ms, FILE *out)
+        : interval(interval), wall_interval(wall_interval_ms), out(out), window_end(interval) {
+        wall_start = wall_deadline = chrono::steady_clock::now();
+        wall_deadline += chrono::milliseconds(wall_interval);
+        buffer.reserve(WINDOW_BUFFER_BYTES + 256);
+    }
+
+    ~WindowedMetrics() { flush(); }
+
+    // How long the arrival source may wait for input before calling idle()
+    int idleTimeoutMs() const { return wall_interval > 0 ? min(wall_interval, WINDOW_IDLE_FLUSH_MS) : WINDOW_IDLE_FLUSH_MS; }
+
+    void completed(const Process &process) {
+        completions++;
+        waiting.record(process.waiting_time);
+    }
+
+    // The simulator moves on to `next`; until then `queued` processes are ready to run
+    void advance(long long next, int queued) {
+        depth = queued;
+        if (interval > 0) {
+            if (window_end > next) {
+                now = next;
+                return;
+            }
+            emit(window_end);
+            // Skip over the windows in which nothing can happen, reporting them as one
+            long long last_end = next / interval * interval;
+            if (last_end > window_start) emit(last_end);
+            window_end = window_start + interval;
+        } else if (wall_interval > 0 && chrono::steady_clock::now() >= wall_deadline) {
+            emit(next);
+        }
+        now = next;
+        if (buffer.size() >= WINDOW_BUFFER_BYTES) flush();
+    }
+
+    // The simulator is waiting for more input
+    void idle() {
+        if (wall_interval > 0 && chrono::steady_clock::now() >= wall_deadline) emit(now);
+        flush();
+    }
+
+    // Reports the last, partial window once the run is over at `end`
+    void finish(long long end) {
+        if (completions > 0 || end > window_start) emit(max(end, window_start));
+        flush();
+    }
+
+private:
+    int interval;
+    int wall_interval;
+    FILE *out;
+    long long window_start = 0;
+    long long window_end;
+    long long now = 0;            // Time the simulator last moved to
+    int depth = 0;                // Ready processes at `now`
+    long long completions = 0;    // Processes completed in the current window
+    LatencyHistogram waiting;
+    chrono::steady_clock::time_point wall_start, wall_deadline;
+    string buffer;
+
+    // Ends the current window at simulated time `end`
+    void emit(long long end) {
+        auto wall_now = chrono::steady_clock::now();
+        char line[256];
+        long long span = end - window_start;
+        double seconds = chrono::duration<double>(wall_now - wall_start).count();
+        double throughput = interval > 0 ? (span > 0 ? (double)completions / span : 0) : (seconds > 0 ? completions / seconds : 0);
+        int length = snprintf(line, sizeof(line),
+                              "Window %lld-%lld: %lld completed, throughput %.6g per %s, queue depth %d, p99 waiting %lld\n",
+                              window_start, end, completions, throughput, interval > 0 ? "time unit" : "second", depth,
+                              waiting.percentile(99));
+        buffer.append(line, min<int>(length, sizeof(line) - 1));
+
+        window_start = end;
+        completions = 0;
+        waiting = LatencyHistogram();
+        wall_start = wall_now;
+        wall_deadline = wall_now + chrono::milliseconds(wall_interval);
+    }
+
+    void flush() {
+        if (buffer.empty()) return;
+        fwrite(buffer.data(), 1, buffer.size(), out);
+        fflush(out);
+        buffer.clear();
+    }
+};
+
+#endif // METRICS_H
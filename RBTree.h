@@ -0,0 +1,265 @@
+// RBTree.h
+#ifndef RB_TREE_H
+#define RB_TREE_H
+
+// Links embedded in every object that can sit in an RBTree, so enqueueing never allocates
+template <typename T>
+struct RBLink {
+    T *parent = nullptr;
+    T *left = nullptr;
+    T *right = nullptr;
+    bool red = false;
+};
+
+// Keeps no per-subtree data
+struct NoAugment {
+    static constexpr bool ENABLED = false;
+    template <typename T> static void update(T *) {}
+};
+
+// Intrusive red-black tree ordered by `Less`, with the leftmost element cached like the
+// kernel's rb_root_cached. Objects are linked through their `Link` member; the tree never
+// owns or copies them. `Less` must define a strict total order (break ties on an id).
+// Like the kernel's augmented rbtree, `Augment::update(node)` can keep a summary of every
+// subtree in its root node: it is called bottom-up whenever a node's children change.
+template <typename T, RBLink<T> T::*Link, typename Less, typename Augment = NoAugment>
+class RBTree {
+public:
+    explicit RBTree(Less less = Less()) : less(less) {}
+
+    bool empty() const { return root == nullptr; }
+    int size() const { return count; }
+    T *first() const { return leftmost; }
+    T *top() const { return root; }
+
+    void insert(T *item) {
+        link(item) = RBLink<T>();
+        link(item).red = true;
+
+        T *parent = nullptr;
+        T *node = root;
+        bool is_leftmost = true;
+        while (node) {
+            parent = node;
+            if (less(item, node)) {
+                node = link(node).left;
+            } else {
+                node = link(node).right;
+                is_leftmost = false;
+            }
+        }
+
+        link(item).parent = parent;
+        if (!parent) root = item;
+        else if (less(item, parent)) link(parent).left = item;
+        else link(parent).right = item;
+        if (is_leftmost) leftmost = item;
+
+        propagate(item);
+        insertFixup(item);
+        count++;
+    }
+
+    void erase(T *item) {
+        if (item == leftmost) {
+            // The leftmost node has no left child, so its successor is the minimum of its right
+            // subtree or, failing that, its parent
+            leftmost = link(item).right ? minimum(link(item).right) : link(item).parent;
+        }
+
+        T *child;
+        T *child_parent;
+        bool removed_red = link(item).red;
+
+        if (!link(item).left) {
+            child = link(item).right;
+            child_parent = link(item).parent;
+            transplant(item, child);
+        } else if (!link(item).right) {
+            child = link(item).left;
+            child_parent = link(item).parent;
+            transplant(item, child);
+        } else {
+            T *next = minimum(link(item).right);
+            removed_red = link(next).red;
+            child = link(next).right;
+            if (link(next).parent == item) {
+                child_parent = next;
+            } else {
+                child_parent = link(next).parent;
+                transplant(next, child);
+                link(next).right = link(item).right;
+                link(link(next).right).parent = next;
+            }
+            transplant(item, next);
+            link(next).left = link(item).left;
+            link(link(next).left).parent = next;
+            link(next).red = link(item).red;
+        }
+
+        propagate(child_parent);
+        if (!removed_red) eraseFixup(child, child_parent);
+        link(item) = RBLink<T>();
+        count--;
+    }
+
+    void clear() {
+        root = nullptr;
+        leftmost = nullptr;
+        count = 0;
+    }
+
+private:
+    Less less;
+    T *root = nullptr;
+    T *leftmost = nullptr;
+    int count = 0;
+
+    static RBLink<T> &link(T *node) { return node->*Link; }
+    static bool isRed(T *node) { return node && link(node).red; }
+
+    // Refreshes the subtree summaries from `node` up to the root
+    static void propagate(T *node) {
+        if (!Augment::ENABLED) return;
+        for (; node; node = link(node).parent) Augment::update(node);
+    }
+
+    static T *minimum(T *node) {
+        while (link(node).left) node = link(node).left;
+        return node;
+    }
+
+    // Puts `replacement` where `node` hangs in the tree
+    void transplant(T *node, T *replacement) {
+        T *parent = link(node).parent;
+        if (!parent) root = replacement;
+        else if (node == link(parent).left) link(parent).left = replacement;
+        else link(parent).right = replacement;
+        if (replacement) link(replacement).parent = parent;
+    }
+
+    void rotateLeft(T *node) {
+        T *pivot = link(node).right;
+        link(node).right = link(pivot).left;
+        if (link(pivot).left) link(link(pivot).left).parent = node;
+        transplant(node, pivot);
+        link(pivot).left = node;
+        link(node).parent = pivot;
+        Augment::update(node);
+        Augment::update(pivot);
+    }
+
+    void rotateRight(T *node) {
+        T *pivot = link(node).left;
+        link(node).left = link(pivot).right;
+        if (link(pivot).right) link(link(pivot).right).parent = node;
+        transplant(node, pivot);
+        link(pivot).right = node;
+        link(node).parent = pivot;
+        Augment::update(node);
+        Augment::update(pivot);
+    }
+
+    void insertFixup(T *node) {
+        while (isRed(link(node).parent)) {
+            T *parent = link(node).parent;
+            T *grandparent = link(parent).parent;
+            if (parent == link(grandparent).left) {
+                T *uncle = link(grandparent).right;
+                if (isRed(uncle)) {
+                    link(parent).red = false;
+                    link(uncle).red = false;
+                    link(grandparent).red = true;
+                    node = grandparent;
+                } else {
+                    if (node == link(parent).right) {
+                        node = parent;
+                        rotateLeft(node);
+                        parent = link(node).parent;
+                    }
+                    link(parent).red = false;
+                    link(grandparent).red = true;
+                    rotateRight(grandparent);
+                }
+            } else {
+                T *uncle = link(grandparent).left;
+                if (isRed(uncle)) {
+                    link(parent).red = false;
+                    link(uncle).red = false;
+                    link(grandparent).red = true;
+                    node = grandparent;
+                } else {
+                    if (node == link(parent).left) {
+                        node = parent;
+                        rotateRight(node);
+                        parent = link(node).parent;
+                    }
+                    link(parent).red = false;
+                    link(grandparent).red = true;
+                    rotateLeft(grandparent);
+                }
+            }
+        }
+        link(root).red = false;
+    }
+
+    // `node` may be null, so its parent is passed in separately
+    void eraseFixup(T *node, T *parent) {
+        while (node != root && !isRed(node)) {
+            if (node == link(parent).left) {
+                T *sibling = link(parent).right;
+                if (isRed(sibling)) {
+                    link(sibling).red = false;
+                    link(parent).red = true;
+                    rotateLeft(parent);
+                    sibling = link(parent).right;
+                }
+                if (!isRed(link(sibling).left) && !isRed(link(sibling).right)) {
+                    link(sibling).red = true;
+                    node = parent;
+                    parent = link(node).parent;
+                } else {
+                    if (!isRed(link(sibling).right)) {
+                        link(link(sibling).left).red = false;
+                        link(sibling).red = true;
+                        rotateRight(sibling);
+                        sibling = link(parent).right;
+                    }
+                    link(sibling).red = link(parent).red;
+                    link(parent).red = false;
+                    link(link(sibling).right).red = false;
+                    rotateLeft(parent);
+                    node = root;
+                }
+            } else {
+                T *sibling = link(parent).left;
+                if (isRed(sibling)) {
+                    link(sibling).red = false;
+                    link(parent).red = true;
+                    rotateRight(parent);
+                    sibling = link(parent).left;
+                }
+                if (!isRed(link(sibling).left) && !isRed(link(sibling).right)) {
+                    link(sibling).red = true;
+                    node = parent;
+                    parent = link(node).parent;
+                } else {
+                    if (!isRed(link(sibling).left)) {
+                        link(link(sibling).right).red = false;
+                        link(sibling).red = true;
+                        rotateLeft(sibling);
+                        sibling = link(parent).left;
+                    }
+                    link(sibling).red = link(parent).red;
+                    link(parent).red = false;
+                    link(link(sibling).left).red = false;
+                    rotateRight(parent);
+                    node = root;
+                }
+            }
+        }
+        if (node) link(node).red = false;
+    }
+};
+
+#endif // RB_TREE_H
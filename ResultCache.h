@@ -0,0 +1,285 @@
+// ResultCache.h
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "Scheduler.h"
+#include "Metrics.h"
+#include "Workload.h"
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Version of the simulation results. Bump it with every change that alters the metrics of a
+// run, so results cached before the change are never used again. Fixes to a policy or to the
+// FIFO scan count too, since they change what a cached run should have reported.
+const uint32_t SIMULATOR_VERSION = 5;
+
+// Size a result cache directory is kept under unless the program is told otherwise
+const long long DEFAULT_CACHE_BYTES = 1LL << 30;
+
+// Temporary files older than this belong to writers that died before renaming them
+const int CACHE_STALE_TEMP_SECONDS = 3600;
+
+// 128-bit hash naming workloads and cache entries by their content. It is not cryptographic;
+// an entry also holds the description it was stored under, and lookups compare it.
+struct ContentHash {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    string hex() const {
+        char text[33];
+        snprintf(text, sizeof(text), "%016llx%016llx", (unsigned long long)high, (unsigned long long)low);
+        return text;
+    }
+};
+
+inline uint64_t rotateLeft(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+// Final avalanche of MurmurHash3
+inline uint64_t mixHash(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+// Hashes 16 bytes per step in two independent lanes, so a workload of hundreds of megabytes
+// hashes in a fraction of the time it takes to parse
+inline ContentHash hashBytes(const char *data, size_t size) {
+    const uint64_t K1 = 0x9e3779b97f4a7c15ULL, K2 = 0xc2b2ae3d27d4eb4fULL;
+    uint64_t a = K1 ^ size, b = K2 + size;
+    auto step = [&](const char *block) {
+        uint64_t x, y;
+        memcpy(&x, block, 8);
+        memcpy(&y, block + 8, 8);
+        a = rotateLeft(a ^ x * K2, 31) * K1;
+        b = rotateLeft(b ^ y * K1, 29) * K2;
+    };
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) step(data + i);
+    char tail[16] = {};
+    memcpy(tail, data + i, size - i);
+    step(tail);
+
+    ContentHash hash;
+    hash.high = mixHash(a + mixHash(b));
+    hash.low = mixHash(b ^ mixHash(a + K1));
+    return hash;
+}
+
+// Hashes the contents of a workload file; returns false if it cannot be mapped
+inline bool hashWorkloadFile(const string &file_path, ContentHash &hash) {
+    MappedFile file(file_path);
+    if (!file.data) return false;
+    hash = hashBytes(file.data, file.size);
+    return true;
+}
+
+// Everything the result of a run depends on besides the simulator version: the workload, the
+// engine that ran it (UniCore or MultiCore), the algorithm and every setting. A setting added
+// to SimConfig or SMPConfig has to be added here too.
+inline string describeRun(const ContentHash &workload, const string &engine, const string &algorithm,
+                          const SimConfig &config, const SMPConfig &smp) {
+    char text[512];
+    snprintf(text, sizeof(text),
+             "workload=%s engine=%s algorithm=%s cores=%d placement=%d stealing=%d balance=%d io=%d "
+             "cfs=%d,%d,%d rr=%d mlfq=%d,%d,%d eevdf=%d switching=%d,%d,%d,%d",
+             workload.hex().c_str(), engine.c_str(), algorithm.c_str(), smp.cores, (int)smp.placement,
+             (int)smp.work_stealing, smp.balance_interval, config.io_devices, config.cfs.sched_latency,
+             config.cfs.min_granularity, config.cfs.wakeup_granularity, config.rr_quantum, config.mlfq.levels,
+             config.mlfq.quantum, config.mlfq.boost_interval, config.eevdf_slice, config.switching.context_switch,
+             config.switching.migration, config.switching.cache_refill, config.switching.cache_half_life);
+    return text;
+}
+
+// Result of one run as the programs report it: the metrics and the time of the last
+// completion of every core, and the wall-clock seconds the simulation took
+struct CachedRun {
+    vector<RunMetrics> metrics;
+    vector<long long> last_completion;
+    double seconds = 0;
+};
+
+// Cache entry file layout, all in host byte order:
+//   ResultCacheHeader
+//   char       description[description_bytes]
+//   RunMetrics metrics[cores]                   as laid out in memory, checked by metrics_bytes
+//   int64      last_completion[cores]
+const char RESULT_CACHE_MAGIC[8] = {'S', 'C', 'H', 'E', 'D', 'R', 'C', '\0'};
+
+struct ResultCacheHeader {
+    char magic[8];
+    uint32_t simulator_version;
+    uint32_t metrics_bytes;
+    uint64_t description_bytes;
+    uint64_t cores;
+    double seconds;
+};
+
+static_assert(is_trivially_copyable<RunMetrics>::value, "cache entries hold RunMetrics as raw bytes");
+
+// Directory of run results, one file per result named by the hash of its description, that
+// several processes may share. An entry is written to a temporary file and renamed into
+// place, so readers only ever see whole entries. Lookups refresh the modification time of the
+// entry they hit, and every store evicts the least recently used entries once the directory
+// holds more than `max_bytes`.
+class ResultCache {
+public:
+    ResultCache(const string &directory, long long max_bytes) : directory(directory), max_bytes(max_bytes) {
+        mkdir(directory.c_str(), 0777);
+    }
+
+    bool opened() const {
+        struct stat info;
+        return stat(directory.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+    }
+
+    // Reads the result stored under `description`; returns false on a miss
+    bool lookup(const string &description, CachedRun &run) const {
+        int fd = open(entryPath(description).c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        vector<char> bytes;
+        struct stat info;
+        bool read_all = fstat(fd, &info) == 0 && readAll(fd, bytes, info.st_size);
+        if (read_all) futimens(fd, nullptr);
+        close(fd);
+        return read_all && decode(bytes, description, run);
+    }
+
+    // Stores `run` under `description`, replacing an earlier result; returns false if the
+    // entry could not be written
+    bool store(const string &description, const CachedRun &run) const {
+        ResultCacheHeader header;
+        memcpy(header.magic, RESULT_CACHE_MAGIC, sizeof(header.magic));
+        header.simulator_version = SIMULATOR_VERSION;
+        header.metrics_bytes = sizeof(RunMetrics);
+        header.description_bytes = description.size();
+        header.cores = run.metrics.size();
+        header.seconds = run.seconds;
+        string bytes((const char *)&header, sizeof(header));
+        bytes += description;
+        bytes.append((const char *)run.metrics.data(), run.metrics.size() * sizeof(RunMetrics));
+        bytes.append((const char *)run.last_completion.data(), run.last_completion.size() * sizeof(int64_t));
+
+        string temp_path = directory + "/.tmp-XXXXXX";
+        int fd = mkstemp(&temp_path[0]);
+        if (fd < 0) return false;
+        fchmod(fd, 0644);
+        bool written = writeAll(fd, bytes.data(), bytes.size()) && fsync(fd) == 0;
+        written = close(fd) == 0 && written;
+        if (!written || rename(temp_path.c_str(), entryPath(description).c_str()) != 0) {
+            unlink(temp_path.c_str());
+            return false;
+        }
+        evict();
+        return true;
+    }
+
+private:
+    string directory;
+    long long max_bytes;
+
+    string entryPath(const string &description) const {
+        return directory + "/" + hashBytes(description.data(), description.size()).hex() + ".result";
+    }
+
+    static bool readAll(int fd, vector<char> &bytes, size_t size) {
+        bytes.resize(size);
+        size_t done = 0;
+        while (done < size) {
+            ssize_t count = read(fd, bytes.data() + done, size - done);
+            if (count <= 0) return false;
+            done += count;
+        }
+        return true;
+    }
+
+    static bool writeAll(int fd, const char *data, size_t size) {
+        while (size > 0) {
+            ssize_t count = write(fd, data, size);
+            if (count <= 0) return false;
+            data += count;
+            size -= count;
+        }
+        return true;
+    }
+
+    // Unpacks an entry, rejecting it if it is damaged, from another simulator version or
+    // build, or a hash collision with another description
+    static bool decode(const vector<char> &bytes, const string &description, CachedRun &run) {
+        ResultCacheHeader header;
+        if (bytes.size() < sizeof(header)) return false;
+        memcpy(&header, bytes.data(), sizeof(header));
+        if (memcmp(header.magic, RESULT_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.simulator_version != SIMULATOR_VERSION || header.metrics_bytes != sizeof(RunMetrics) ||
+            header.description_bytes != description.size()) {
+            return false;
+        }
+        size_t cores = header.cores;
+        if (cores > bytes.size() ||
+            bytes.size() != sizeof(header) + description.size() + cores * (sizeof(RunMetrics) + sizeof(int64_t))) {
+            return false;
+        }
+        const char *p = bytes.data() + sizeof(header);
+        if (memcmp(p, description.data(), description.size()) != 0) return false;
+        p += description.size();
+        run.metrics.resize(cores);
+        memcpy((void *)run.metrics.data(), p, cores * sizeof(RunMetrics));
+        p += cores * sizeof(RunMetrics);
+        run.last_completion.resize(cores);
+        memcpy(run.last_completion.data(), p, cores * sizeof(int64_t));
+        run.seconds = header.seconds;
+        return true;
+    }
+
+    // Removes the least recently used entries until the directory fits in max_bytes, along
+    // with temporary files left behind by writers that died. Entries another process removes
+    // at the same time are skipped.
+    void evict() const {
+        struct Entry {
+            timespec used;
+            long long bytes;
+            string path;
+        };
+        vector<Entry> entries;
+        long long total = 0;
+        time_t now = time(nullptr);
+        DIR *listing = opendir(directory.c_str());
+        if (!listing) return;
+        while (dirent *item = readdir(listing)) {
+            string name = item->d_name;
+            string path = directory + "/" + name;
+            struct stat info;
+            bool result = name.size() > 7 && name.compare(name.size() - 7, 7, ".result") == 0;
+            bool temp = name.compare(0, 5, ".tmp-") == 0;
+            if ((!result && !temp) || stat(path.c_str(), &info) != 0) continue;
+            if (temp) {
+                if (now - info.st_mtime > CACHE_STALE_TEMP_SECONDS) unlink(path.c_str());
+                continue;
+            }
+            entries.push_back({info.st_mtim, (long long)info.st_size, path});
+            total += info.st_size;
+        }
+        closedir(listing);
+        if (total <= max_bytes) return;
+
+        sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+            return a.used.tv_sec != b.used.tv_sec ? a.used.tv_sec < b.used.tv_sec : a.used.tv_nsec < b.used.tv_nsec;
+        });
+        for (const Entry &entry : entries) {
+            if (total <= max_bytes) break;
+            unlink(entry.path.c_str());
+            total -= entry.bytes;
+        }
+    }
+};
+
+#endif // RESULT_CACHE_H
@@ -12,67 +12,457 @@
 #include <numeric>
 #include <sstream>
 #include <chrono>
+#include "RBTree.h"
+#include "Trace.h"
 
 using namespace std;
 
-// Declaration of the Process struct
+// Deadline of processes whose workload line has none; they run after every process with one
+const int NO_DEADLINE = INT_MAX;
+
+// Read-only view of a workload in the layout of Workload, over arrays owned by someone else.
+// Nothing is copied, so the arrays must outlive every run over the view. Processes must be
+// sorted by arrival time. `id`, `nice` and `deadline` may be null, meaning ids are positions
+// in the view, nice 0 and no deadlines.
+struct WorkloadView {
+    size_t processes = 0;
+    const int *arrival_time = nullptr;
+    const size_t *burst_offset = nullptr;   // One more entry than there are processes
+    const int *bursts = nullptr;
+    const int *id = nullptr;
+    const int *nice = nullptr;
+    const int *deadline = nullptr;
+
+    size_t size() const { return processes; }
+};
+
+// Parsed workload in structure-of-arrays form, sorted by arrival time. The bursts of all
+// processes share one array: process i owns bursts[burst_offset[i] .. burst_offset[i + 1]),
+// alternating CPU and I/O bursts and starting with a CPU burst.
+struct Workload {
+    vector<int> id;                      // Line of the process in the workload file
+    vector<int> arrival_time;
+    vector<int> nice;
+    vector<int> deadline;                // Absolute completion deadline, NO_DEADLINE if none
+    vector<size_t> burst_offset{0};      // One more entry than there are processes
+    vector<int> bursts;
+    vector<long long> total_cpu_time;    // Sum of each process's CPU bursts
+
+    size_t size() const { return arrival_time.size(); }
+
+    WorkloadView view() const {
+        WorkloadView view;
+        view.processes = size();
+        view.arrival_time = arrival_time.data();
+        view.burst_offset = burst_offset.data();
+        view.bursts = bursts.data();
+        view.id = id.data();
+        view.nice = nice.data();
+        view.deadline = deadline.data();
+        return view;
+    }
+
+    // Removes every process, keeping the memory for the next ones
+    void clear() {
+        id.clear();
+        arrival_time.clear();
+        nice.clear();
+        deadline.clear();
+        burst_offset.assign(1, 0);
+        bursts.clear();
+        total_cpu_time.clear();
+    }
+
+    // Adds a process owning the bursts appended since the previous call
+    void addProcess(int process_id, int arrival, int nice_value, int deadline_value = NO_DEADLINE) {
+        id.push_back(process_id);
+        arrival_time.push_back(arrival);
+        nice.push_back(nice_value);
+        deadline.push_back(deadline_value);
+        long long cpu_time = 0;
+        for (size_t i = burst_offset.back(); i < bursts.size(); i += 2) cpu_time += bursts[i];
+        total_cpu_time.push_back(cpu_time);
+        burst_offset.push_back(bursts.size());
+    }
+
+    // Appends every process of `other`, shifting their ids by `id_offset`
+    void append(const Workload &other, int id_offset) {
+        for (int other_id : other.id) id.push_back(other_id + id_offset);
+        arrival_time.insert(arrival_time.end(), other.arrival_time.begin(), other.arrival_time.end());
+        nice.insert(nice.end(), other.nice.begin(), other.nice.end());
+        deadline.insert(deadline.end(), other.deadline.begin(), other.deadline.end());
+        total_cpu_time.insert(total_cpu_time.end(), other.total_cpu_time.begin(), other.total_cpu_time.end());
+        size_t base = bursts.size();
+        for (size_t i = 1; i < other.burst_offset.size(); i++) burst_offset.push_back(base + other.burst_offset[i]);
+        bursts.insert(bursts.end(), other.bursts.begin(), other.bursts.end());
+    }
+};
+
+// Declaration of the Process struct: the mutable state of one process during a run. Bursts
+// are read in place from the workload or view, which must outlive the process. Workload
+// values are int, but times during a run are 64-bit, since a long trace ends past INT_MAX.
 struct Process {
     int id;
     int arrival_time;
-    vector<int> cpu_bursts;
-    vector<int> io_bursts;
-    int current_burst;
+    const int *bursts;          // CPU and I/O bursts interleaved, inside Workload::bursts
+    int burst_count;
+    int current_burst;          // Index of the current CPU burst
     int remaining_time;
-    int turnaround_time;
-    int waiting_time;
-    int completion_time;
+    long long turnaround_time;
+    long long waiting_time;     // Total time spent in the ready queue
+    long long completion_time;
+    long long state_since;      // Time the process became ready or blocked
+    long long first_run_time;   // Time the process first got the CPU, -1 until then
+    int slot;                   // Position of the process in its run's process storage
+    int nice;                   // Nice level from -20 to 19, optional value after the -1 terminator
+    int deadline;               // Absolute deadline, optional value after nice, NO_DEADLINE if none
+    int weight;                 // CFS load weight derived from nice
+    long long vruntime;         // CFS and EEVDF virtual runtime in 1/1024 time units
+    RBLink<Process> run_node;   // Links into the CFS or EEVDF run queue
+    long long virtual_deadline; // EEVDF virtual deadline of the current request
+    long long min_virtual_deadline; // EEVDF: smallest virtual deadline in this run_node subtree
+    long long lag;              // EEVDF lag kept while the process is blocked or migrating
+    Process *next_queued;       // Links into a ProcessQueue: a FIFO run queue, an MLFQ level or a device wait queue
+    int level;                  // MLFQ priority level, 0 is the highest
+    int level_time;             // MLFQ time used at the current level
+    long long boost_epoch;      // MLFQ priority boost the level was last set in
+    int last_core;              // Core the process last ran on, -1 before it first runs
+    long long last_ran;         // Time the process last left the CPU
+    int live_index;             // Position among the processes in the system, kept only while checkpointing
+
+    Process(const WorkloadView &workload, size_t index);
+    Process(const Workload &workload, size_t index) : Process(workload.view(), index) {}
+
+    int cpuBurst(int k) const { return bursts[2 * k]; }
+    int ioBurst(int k) const { return bursts[2 * k + 1]; }
+};
+
+// Tunables of the CFS scheduler, in simulated time units
+struct CFSParams {
+    int sched_latency = 48;       // Period in which every runnable process should run once
+    int min_granularity = 6;      // Shortest slice a process gets when many are runnable
+    int wakeup_granularity = 8;   // vruntime lead a new arrival needs to preempt the running process
+};
+
+// Load weight of each nice level from -20 to 19, as in the Linux kernel
+const int NICE_0_WEIGHT = 1024;
+const int NICE_TO_WEIGHT[40] = {
+    88761, 71755, 56483, 46273, 36291,
+    29154, 23254, 18705, 14949, 11916,
+     9548,  7620,  6100,  4904,  3906,
+     3121,  2501,  1991,  1586,  1277,
+     1024,   820,   655,   526,   423,
+      335,   272,   215,   172,   137,
+      110,    87,    70,    56,    45,
+       36,    29,    23,    18,    15,
+};
+
+inline int niceToWeight(int nice) {
+    return NICE_TO_WEIGHT[min(max(nice, -20), 19) + 20];
+}
+
+// Virtual runtime gained by running `delta` time units at `weight`, in 1/1024 time units
+inline long long vruntimeDelta(long long delta, int weight) {
+    return (delta << 10) * NICE_0_WEIGHT / weight;
+}
+
+// Length of the slice a process of `weight` gets out of the scheduling period
+inline int cfsSlice(const CFSParams &params, int nr_running, long long total_weight, int weight) {
+    long long period = max((long long)params.sched_latency, (long long)nr_running * params.min_granularity);
+    long long slice = max(period * weight / total_weight, (long long)params.min_granularity);
+    return (int)max(slice, 1LL);
+}
+
+// CFS run queue ordered by vruntime, ties broken by id so equal keys never collide
+struct ByVruntime {
+    bool operator()(const Process *a, const Process *b) const {
+        if (a->vruntime != b->vruntime) return a->vruntime < b->vruntime;
+        return a->id < b->id;
+    }
+};
+typedef RBTree<Process, &Process::run_node, ByVruntime> CFSRunQueue;
+
+// Keeps the earliest virtual deadline of every EEVDF run queue subtree in its root
+struct MinVirtualDeadline {
+    static constexpr bool ENABLED = true;
+    static void update(Process *node) {
+        long long earliest = node->virtual_deadline;
+        if (node->run_node.left) earliest = min(earliest, node->run_node.left->min_virtual_deadline);
+        if (node->run_node.right) earliest = min(earliest, node->run_node.right->min_virtual_deadline);
+        node->min_virtual_deadline = earliest;
+    }
+};
+typedef RBTree<Process, &Process::run_node, ByVruntime, MinVirtualDeadline> EEVDFRunQueue;
+
+// Tunables of the multi-level feedback queue
+struct MLFQParams {
+    int levels = 3;               // Priority levels, at most 32
+    int quantum = 8;              // Time a process may use at the top level; doubles with every level down
+    int boost_interval = 1000;    // Period after which every process returns to the top level, 0 to disable
+};
+
+// CPU time a core loses when it changes the process it runs, in simulated time units
+struct SwitchCosts {
+    int context_switch = 0;    // Saving one process's state and loading another's
+    int migration = 0;         // Extra cost when the process last ran on another core
+    int cache_refill = 0;      // Refilling a cold cache; a process that migrated always pays all of it
+    int cache_half_life = 0;   // Time away from its core in which half of a process's cache is evicted, 0 if all at once
+};
+
+class WindowedMetrics;
+
+// Settings shared by every scheduler run
+struct SimConfig {
+    CFSParams cfs;
+    MLFQParams mlfq;
+    SwitchCosts switching;
+    int rr_quantum = 10;          // Round-robin time slice
+    int eevdf_slice = 6;          // Length of an EEVDF request, which sets its virtual deadline
+    int io_devices = 1;   // Number of I/O devices that blocked processes contend for
+    Tracer *trace = nullptr;   // Event trace of the run, null when tracing is off
+    WindowedMetrics *windows = nullptr;   // Metrics reported window by window, null unless running live
+};
+
+// How arriving and waking processes are assigned to cores
+enum class Placement {
+    Static,        // Core id % cores, whatever the load
+    LeastLoaded    // Core with the fewest running and queued processes
+};
+
+struct SMPConfig {
+    int cores = 2;
+    Placement placement = Placement::Static;
+    bool work_stealing = false;   // A core that runs dry takes a process from the longest run queue
+    int balance_interval = 0;     // Period of the load balancer in time units, 0 to disable
+
+    // Without dynamic placement cores never interact and can be simulated on separate timelines
+    bool sharedTimeline() const {
+        return placement != Placement::Static || work_stealing || balance_interval > 0;
+    }
+};
+
+// Whether the process blocks for I/O after its current CPU burst. An I/O burst that is
+// not followed by another CPU burst is ignored.
+inline bool hasNextBurst(const Process &process) {
+    return 2 * process.current_burst + 2 < process.burst_count;
+}
+
+// Hands the CPU to a ready process at `now`, ending its wait in the ready queue
+inline void startRunning(Process &process, long long now) {
+    process.waiting_time += now - process.state_since;
+    if (process.first_run_time < 0) process.first_run_time = now;
+}
+
+// FIFO of processes linked through Process::next_queued, so queueing never allocates. A
+// process is on at most one such queue at a time, as it is either ready or blocked.
+struct ProcessQueue {
+    Process *head = nullptr;
+    Process *tail = nullptr;
+    int count = 0;
+
+    bool empty() const { return head == nullptr; }
+    int size() const { return count; }
+    Process *front() const { return head; }
+
+    void push(Process *process) {
+        process->next_queued = nullptr;
+        if (tail) tail->next_queued = process;
+        else head = process;
+        tail = process;
+        count++;
+    }
+
+    Process *pop() {
+        Process *process = head;
+        head = process->next_queued;
+        if (!head) tail = nullptr;
+        process->next_queued = nullptr;
+        count--;
+        return process;
+    }
+
+    // Moves every process of `other` to the end of this queue
+    void splice(ProcessQueue &other) {
+        if (other.empty()) return;
+        if (tail) tail->next_queued = other.head;
+        else head = other.head;
+        tail = other.tail;
+        count += other.count;
+        other = ProcessQueue();
+    }
+};
+
+// I/O request in service on `device` that finishes at `time`
+struct WakeEvent {
+    long long time;
+    int device;
+
+    bool operator>(const WakeEvent &other) const {
+        if (time != other.time) return time > other.time;
+        return device > other.device;
+    }
+};
+
+// I/O devices that processes block on between CPU bursts. Each device serves its wait queue
+// one request at a time in FIFO order, and the request in service ends with a wake-up event.
+// Process i always uses device i % count. Only requests in service have an event, so the
+// event heap is sized once for every device and blocking never allocates.
+struct IODevices {
+    vector<ProcessQueue> wait_queues;   // The front of each queue is the request in service
+    vector<WakeEvent> wakeups;          // Min-heap on time, then device
+    int blocked = 0;
+
+    explicit IODevices(int count) : wait_queues(max(count, 1)) { wakeups.reserve(wait_queues.size()); }
+
+    bool empty() const { return blocked == 0; }
+    long long nextWakeupTime() const { return wakeups.empty() ? LLONG_MAX : wakeups.front().time; }
+
+    // Queues the I/O burst that follows the process's current CPU burst
+    void block(Process *process, long long now) {
+        int device = process->id % wait_queues.size();
+        process->state_since = now;
+        wait_queues[device].push(process);
+        blocked++;
+        if (wait_queues[device].size() == 1) pushWakeup({now + process->ioBurst(process->current_burst), device});
+    }
+
+    // Finishes the earliest I/O request, starts the next one on the same device and moves the
+    // woken process on to its next CPU burst
+    Process *wake() {
+        pop_heap(wakeups.begin(), wakeups.end(), greater<WakeEvent>());
+        WakeEvent event = wakeups.back();
+        wakeups.pop_back();
+        ProcessQueue &wait_queue = wait_queues[event.device];
+        Process *process = wait_queue.pop();
+        blocked--;
+
+        if (!wait_queue.empty()) {
+            Process *next = wait_queue.front();
+            long long start = max(event.time, next->state_since);
+            pushWakeup({start + next->ioBurst(next->current_burst), event.device});
+        }
 
-    Process(int id, int arrival_time, vector<int> cpu_bursts, vector<int> io_bursts);
+        process->current_burst++;
+        process->remaining_time = process->cpuBurst(process->current_burst);
+        process->state_since = event.time;
+        return process;
+    }
+
+private:
+    void pushWakeup(const WakeEvent &event) {
+        wakeups.push_back(event);
+        push_heap(wakeups.begin(), wakeups.end(), greater<WakeEvent>());
+    }
+};
+
+inline Process *processAt(vector<Process> &processes, size_t index) { return &processes[index]; }
+inline Process *processAt(vector<Process*> &processes, size_t index) { return processes[index]; }
+
+// Arrival source over processes held in memory and sorted by arrival: either a run's own
+// vector<Process> or pointers to processes owned elsewhere. The simulator admits processes
+// through pending/admit and releases them once they complete.
+template <typename Element>
+struct ProcessArray {
+    vector<Element> &processes;
+    size_t next_arrival = 0;   // Everything before this index has been admitted
+
+    explicit ProcessArray(vector<Element> &processes) : processes(processes) {}
+
+    bool pending() const { return next_arrival < processes.size(); }
+    long long nextArrivalTime() const { return pending() ? processAt(processes, next_arrival)->arrival_time : LLONG_MAX; }
+    Process *admit() { return processAt(processes, next_arrival++); }
+    void release(Process *) {}
 };
 
 // Function prototypes
-vector<Process> parseWorkloadFile(const string &file_path);
-void runFIFO(vector<Process> &processes);
-void runNonPreemptiveSJF(vector<Process> &processes);
-void runPreemptiveSJF(vector<Process> &processes);
-void runCFS(vector<Process> &processes);
+inline bool parseWorkloadFile(const string &file_path, Workload &workload);  // Defined in Workload.h
+inline Workload parseWorkloadStream(istream &input);
+inline void sortByArrival(Workload &workload);
+inline vector<Process> makeProcesses(const Workload &workload);
+inline void makeProcesses(const Workload &workload, vector<Process> &processes);
+inline void makeProcesses(const WorkloadView &workload, vector<Process> &processes);
 
 // Definition of the Process constructor
-Process::Process(int id, int arrival_time, vector<int> cpu_bursts, vector<int> io_bursts)
-    : id(id), arrival_time(arrival_time), cpu_bursts(cpu_bursts), io_bursts(io_bursts),
-      current_burst(0), remaining_time(cpu_bursts.empty() ? 0 : cpu_bursts[0]),
-      turnaround_time(0), waiting_time(0), completion_time(0) {}
-
-// Function to parse the workload file and create a list of processes
-vector<Process> parseWorkloadFile(const string &file_path) {
-    ifstream infile(file_path);
-    vector<Process> processes;  
-    int arrival_time, burst;
+inline Process::Process(const WorkloadView &workload, size_t index)
+    : id(workload.id ? workload.id[index] : index), arrival_time(workload.arrival_time[index]),
+      bursts(workload.bursts + workload.burst_offset[index]),
+      burst_count(workload.burst_offset[index + 1] - workload.burst_offset[index]),
+      current_burst(0), remaining_time(burst_count == 0 ? 0 : bursts[0]),
+      turnaround_time(0), waiting_time(0), completion_time(0), state_since(arrival_time), first_run_time(-1), slot(index),
+      nice(workload.nice ? workload.nice[index] : 0), deadline(workload.deadline ? workload.deadline[index] : NO_DEADLINE),
+      weight(niceToWeight(nice)), vruntime(0),
+      virtual_deadline(0), min_virtual_deadline(0), lag(0), next_queued(nullptr), level(0), level_time(0), boost_epoch(0),
+      last_core(-1), last_ran(0), live_index(-1) {}
+
+// Creates fresh run state for every process of the workload, in arrival order
+inline vector<Process> makeProcesses(const Workload &workload) {
+    vector<Process> processes;
+    makeProcesses(workload, processes);
+    return processes;
+}
+
+// Same, refilling the storage of an earlier run so runs in a loop do not allocate
+inline void makeProcesses(const Workload &workload, vector<Process> &processes) {
+    makeProcesses(workload.view(), processes);
+}
+
+inline void makeProcesses(const WorkloadView &workload, vector<Process> &processes) {
+    processes.clear();
+    processes.reserve(workload.size());
+    for (size_t i = 0; i < workload.size(); i++) processes.emplace_back(workload, i);
+}
+
+// Function to parse a workload read line by line from a stream. Lines without an
+// arrival time are skipped.
+inline Workload parseWorkloadStream(istream &input) {
+    Workload workload;
+    int arrival_time, burst, nice, deadline;
     int process_id = 0;
     string line;
 
     // Outer loop: Reads each line for a new process
-    while (getline(infile, line)) {
+    while (getline(input, line)) {
         istringstream iss(line);
-        iss >> arrival_time;  // Read arrival time for a new process
-
-        vector<int> cpu_bursts;
-        vector<int> io_bursts;
+        if (!(iss >> arrival_time)) continue;  // Read arrival time for a new process
 
         // Inner loop: Reads bursts until -1 is found
         while (iss >> burst && burst != -1) {
-            cpu_bursts.push_back(burst);  // Add CPU burst
+            workload.bursts.push_back(burst);  // Add CPU burst
 
-            if (iss >> burst && burst != -1) {  // Read IO burst if available
-                io_bursts.push_back(burst);
-            }
+            if (!(iss >> burst) || burst == -1) break;  // Read IO burst if available
+            workload.bursts.push_back(burst);
         }
 
-        // Add the parsed process to the list
-        processes.emplace_back(process_id++, arrival_time, cpu_bursts, io_bursts);
+        // An optional nice value and then an optional deadline may follow the terminator
+        if (!(iss >> nice)) nice = 0;
+        if (!(iss >> deadline)) deadline = NO_DEADLINE;
+
+        // Add the parsed process to the workload
+        workload.addProcess(process_id++, arrival_time, nice, deadline);
     }
 
-    return processes;
+    sortByArrival(workload);
+    return workload;
+}
+
+// Reorders the workload by arrival time, keeping file order among equal arrivals, so
+// schedulers can admit processes with a moving cursor
+inline void sortByArrival(Workload &workload) {
+    if (is_sorted(workload.arrival_time.begin(), workload.arrival_time.end())) return;
+
+    vector<size_t> order(workload.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(),
+                [&workload](size_t a, size_t b) { return workload.arrival_time[a] < workload.arrival_time[b]; });
+
+    Workload sorted;
+    sorted.bursts.reserve(workload.bursts.size());
+    for (size_t i : order) {
+        sorted.bursts.insert(sorted.bursts.end(), workload.bursts.begin() + workload.burst_offset[i],
+                             workload.bursts.begin() + workload.burst_offset[i + 1]);
+        sorted.addProcess(workload.id[i], workload.arrival_time[i], workload.nice[i], workload.deadline[i]);
+    }
+    workload = move(sorted);
 }
 
 
@@ -0,0 +1,37 @@
+// SchedulerLibrary.h
+#ifndef SCHEDULER_LIBRARY_H
+#define SCHEDULER_LIBRARY_H
+
+#include "Scheduler.h"
+#include "Metrics.h"
+
+using namespace std;
+
+// Interface of libscheduler, which runs simulations in process for programs that would
+// otherwise run main and read its output. Programs include this header instead of
+// Simulator.h and link libscheduler.a or libscheduler.so.
+
+// Outcome of one run
+struct RunResult {
+    RunMetrics metrics;         // Summed over all cores
+    long long makespan = 0;     // Time of the last completion on any core
+    long long events = 0;       // Points in time the simulator stopped at, none for FIFO run as a scan
+    long long decisions = 0;    // Times a process was picked to run
+};
+
+// Reusable state for runs through the library. The process state of one run is kept for the
+// next, so a context running workloads of similar size reuses its memory instead of
+// allocating it again. A context serves one thread at a time; give every worker its own.
+class RunContext {
+public:
+    // Simulates `algorithm` over `workload` on the cores of `smp` and stores the outcome in
+    // `result`. The workload is only read. Returns false for an unknown algorithm or fewer
+    // than one core.
+    bool run(const WorkloadView &workload, const string &algorithm, const SimConfig &config, const SMPConfig &smp,
+             RunResult &result);
+
+private:
+    vector<Process> processes;
+};
+
+#endif // SCHEDULER_LIBRARY_H
@@ -0,0 +1,1066 @@
+// Simulator.h
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include "Scheduler.h"
+#include "Metrics.h"
+#include "Memory.h"
+
+// Orders a priority_queue so the process with the shortest remaining burst is on top, ties
+// broken by arrival and then by id
+struct LongerRemaining {
+    bool operator()(const Process *a, const Process *b) const {
+        if (a->remaining_time != b->remaining_time) return a->remaining_time > b->remaining_time;
+        if (a->arrival_time != b->arrival_time) return a->arrival_time > b->arrival_time;
+        return a->id > b->id;
+    }
+};
+
+// Events between two samples of the phase times, a power of two
+const long long PHASE_SAMPLE_EVENTS = 1024;
+
+// Wall-clock nanoseconds for timing the phases of the simulation loop
+inline long long phaseClock() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Time a phaseClock() reading itself adds to an interval. Phases last tens of nanoseconds,
+// about as long as reading the clock, so the readings would otherwise dominate them.
+inline long long phaseClockOverhead() {
+    static const long long overhead = [] {
+        const int readings = 1000;
+        long long start = phaseClock();
+        for (int i = 0; i < readings; i++) phaseClock();
+        return (phaseClock() - start) / (readings + 1);
+    }();
+    return overhead;
+}
+
+// Work done by a simulation run, for benchmarking and --stats. Every core keeps the run queue
+// counters of its own; the simulator keeps the rest and sums them for the run. The loop as a
+// whole is timed exactly, and its phases only at every PHASE_SAMPLE_EVENTS-th event, so the
+// timer costs next to nothing: the loop time is split between them as the samples are.
+struct SimCounters {
+    long long events = 0;      // Points in time the simulator stopped at
+    long long idle_skips = 0;  // Of those, jumps over time in which no core ran anything
+    long long decisions = 0;   // Times a process was picked to run
+    long long queue_operations = 0;   // Insertions into and removals from run queues
+    long long preemptions = 0;        // Times a process was put back before its burst ended
+    int peak_queue_depth = 0;         // Most processes ready at once on one core
+    long long queue_depth_time = 0;   // Ready processes summed over simulated time, for the average
+    long long end_time = 0;           // Time of the last event
+    long long allocations = 0; // Heap allocations made by the event loop
+    long long loop_ns = 0;     // Time in the event loop
+    // Sampled time of each phase: finding the next event (and waiting for input), placing
+    // arrivals and wake-ups, picking, preempting and balancing, and charging running processes
+    long long sampled_next_ns = 0, sampled_admit_ns = 0, sampled_select_ns = 0, sampled_account_ns = 0;
+
+    double averageQueueDepth() const { return end_time > 0 ? (double)queue_depth_time / end_time : 0; }
+
+    // Share of the loop time that went to a phase, from its samples
+    double phaseSeconds(long long sampled_ns) const {
+        long long sampled = sampled_next_ns + sampled_admit_ns + sampled_select_ns + sampled_account_ns;
+        return sampled > 0 ? loop_ns / 1e9 * sampled_ns / sampled : 0;
+    }
+
+    void merge(const SimCounters &other) {
+        events += other.events;
+        idle_skips += other.idle_skips;
+        decisions += other.decisions;
+        queue_operations += other.queue_operations;
+        preemptions += other.preemptions;
+        peak_queue_depth = max(peak_queue_depth, other.peak_queue_depth);
+        queue_depth_time += other.queue_depth_time;
+        end_time = max(end_time, other.end_time);
+        allocations += other.allocations;
+        loop_ns += other.loop_ns;
+        sampled_next_ns += other.sampled_next_ns;
+        sampled_admit_ns += other.sampled_admit_ns;
+        sampled_select_ns += other.sampled_select_ns;
+        sampled_account_ns += other.sampled_account_ns;
+    }
+};
+
+// Prints the counters of a run for --stats, as text lines or with `json` as one JSON object.
+// `parse_seconds` is the time spent reading the workload; `per_core` breaks the run queue
+// counters down by processor when there is more than one.
+inline void printStats(const string &name, const SimCounters &total, const vector<SimCounters> &per_core,
+                       double parse_seconds, bool json) {
+    double loop = total.loop_ns / 1e9, admit = total.phaseSeconds(total.sampled_admit_ns);
+    double select = total.phaseSeconds(total.sampled_select_ns), account = total.phaseSeconds(total.sampled_account_ns);
+    double next = max(loop - admit - select - account, 0.0);
+    char line[512];
+    if (!json) {
+        cout << name << " Stats: " << total.events << " events, " << total.idle_skips << " idle skips, "
+             << total.decisions << " decisions, " << total.queue_operations << " ready-queue operations, "
+             << total.preemptions << " preemptions, " << total.allocations << " allocations\n";
+        snprintf(line, sizeof(line), "%s Stats: ready-queue depth peak %d, average %.3f\n", name.c_str(),
+                 total.peak_queue_depth, total.averageQueueDepth());
+        cout << line;
+        snprintf(line, sizeof(line),
+                 "%s Stats: seconds in parse %.6f, next event %.6f, admit %.6f, select %.6f, account %.6f (loop %.6f)\n",
+                 name.c_str(), parse_seconds, next, admit, select, account, loop);
+        cout << line;
+        if (per_core.size() < 2) return;
+        for (size_t i = 0; i < per_core.size(); i++) {
+            const SimCounters &core = per_core[i];
+            snprintf(line, sizeof(line),
+                     "%s Stats: Processor %zu: %lld decisions, %lld ready-queue operations, %lld preemptions, "
+                     "ready-queue depth peak %d, average %.3f\n",
+                     name.c_str(), i, core.decisions, core.queue_operations, core.preemptions, core.peak_queue_depth,
+                     core.averageQueueDepth());
+            cout << line;
+        }
+        return;
+    }
+
+    string out = "{\"algorithm\": \"" + name + "\"";
+    snprintf(line, sizeof(line),
+             ", \"events\": %lld, \"idle_skips\": %lld, \"decisions\": %lld, \"queue_operations\": %lld, "
+             "\"preemptions\": %lld, \"allocations\": %lld, \"peak_queue_depth\": %d, \"average_queue_depth\": %.3f",
+             total.events, total.idle_skips, total.decisions, total.queue_operations, total.preemptions,
+             total.allocations, total.peak_queue_depth, total.averageQueueDepth());
+    out += line;
+    snprintf(line, sizeof(line),
+             ", \"seconds\": {\"parse\": %.6f, \"next\": %.6f, \"admit\": %.6f, \"select\": %.6f, "
+             "\"account\": %.6f, \"loop\": %.6f}",
+             parse_seconds, next, admit, select, account, loop);
+    out += line;
+    if (per_core.size() >= 2) {
+        out += ", \"processors\": [";
+        for (size_t i = 0; i < per_core.size(); i++) {
+            const SimCounters &core = per_core[i];
+            snprintf(line, sizeof(line),
+                     "%s{\"processor\": %zu, \"decisions\": %lld, \"queue_operations\": %lld, \"preemptions\": %lld, "
+                     "\"peak_queue_depth\": %d, \"average_queue_depth\": %.3f}",
+                     i > 0 ? ", " : "", i, core.decisions, core.queue_operations, core.preemptions,
+                     core.peak_queue_depth, core.averageQueueDepth());
+            out += line;
+        }
+        out += "]";
+    }
+    cout << out << "}\n";
+}
+
+// Scheduling policies. A policy is the run queue of one core: it decides the order in which
+// the core runs processes, whether a queued process preempts the running one and how long the
+// running one may keep the CPU. The simulator calls it directly, so everything inlines.
+//   NAME                    Name used in reports
+//   PREEMPTIVE              Whether shouldPreempt or slice can ever take the CPU away
+//   enqueue(process)        Takes an arrival or a wake-up
+//   requeue(process)        Takes a process that was preempted or used up its slice
+//   pick()                  Removes the process to run next
+//   shouldPreempt(running)  Whether the next queued process should replace the running one
+//   slice(running)          How long the running process may run before it is requeued
+//   charge(running, time)   Accounts for time the running process spent on the CPU
+//   retire(running)         Takes back the running process when it blocks or completes
+//   nextTimer() / timer(t)  When the policy next needs to run periodic work, and that work
+//   detach() / attach(p)    Move a queued process to another core's policy
+//   reserve(processes)      Sizes the queue up front so the run does not allocate
+// PolicyBase has the defaults of everything but the queue itself.
+
+struct PolicyBase {
+    void reserve(size_t) {}
+    bool shouldPreempt(const Process *) const { return false; }
+    int slice(const Process *) const { return INT_MAX; }
+    void charge(Process *, int) {}
+    void retire(Process *) {}
+    long long nextTimer() const { return LLONG_MAX; }
+    void timer(long long) {}
+};
+
+struct FIFOPolicy : PolicyBase {
+    static constexpr const char *NAME = "FIFO";
+    static constexpr bool PREEMPTIVE = false;
+
+    ProcessQueue queue;
+
+    explicit FIFOPolicy(const SimConfig &) {}
+
+    bool empty() const { return queue.empty(); }
+    int size() const { return queue.size(); }
+    void enqueue(Process *process) { queue.push(process); }
+    void requeue(Process *process) { queue.push(process); }
+    Process *pick() { return queue.pop(); }
+    Process *detach() { return pick(); }
+    void attach(Process *process) { queue.push(process); }
+};
+
+// FIFO that takes the CPU back after a fixed quantum
+struct RoundRobinPolicy : FIFOPolicy {
+    static constexpr const char *NAME = "RR";
+    static constexpr bool PREEMPTIVE = true;
+
+    int quantum;
+
+    explicit RoundRobinPolicy(const SimConfig &config) : FIFOPolicy(config), quantum(max(config.rr_quantum, 1)) {}
+
+    int slice(const Process *) const { return quantum; }
+};
+
+// Runs the queued process that `Later` puts first; with `Preemptive` that process also takes
+// the CPU as soon as it would be ordered before the running one
+template <typename Later, bool Preemptive>
+struct PriorityPolicy : PolicyBase {
+    static constexpr bool PREEMPTIVE = Preemptive;
+
+    vector<Process*> heap;   // Binary heap with the process `Later` puts first at the front
+
+    explicit PriorityPolicy(const SimConfig &) {}
+
+    void reserve(size_t processes) { heap.reserve(processes); }
+    bool empty() const { return heap.empty(); }
+    int size() const { return heap.size(); }
+    void enqueue(Process *process) {
+        heap.push_back(process);
+        push_heap(heap.begin(), heap.end(), Later());
+    }
+    void requeue(Process *process) { enqueue(process); }
+    Process *pick() {
+        pop_heap(heap.begin(), heap.end(), Later());
+        Process *process = heap.back();
+        heap.pop_back();
+        return process;
+    }
+    bool shouldPreempt(const Process *running) const {
+        return Preemptive && !heap.empty() && Later()(running, heap.front());
+    }
+    Process *detach() { return pick(); }
+    void attach(Process *process) { enqueue(process); }
+};
+
+struct SJFPolicy : PriorityPolicy<LongerRemaining, false> {
+    static constexpr const char *NAME = "Non-Preemptive SJF";
+    using PriorityPolicy::PriorityPolicy;
+};
+
+struct PreemptiveSJFPolicy : PriorityPolicy<LongerRemaining, true> {
+    static constexpr const char *NAME = "Preemptive SJF";
+    using PriorityPolicy::PriorityPolicy;
+};
+
+// Orders a priority_queue so the process with the earliest deadline is on top, ties broken by
+// arrival and then by id; processes without a deadline come last
+struct LaterDeadline {
+    bool operator()(const Process *a, const Process *b) const {
+        if (a->deadline != b->deadline) return a->deadline > b->deadline;
+        if (a->arrival_time != b->arrival_time) return a->arrival_time > b->arrival_time;
+        return a->id > b->id;
+    }
+};
+
+struct EDFPolicy : PriorityPolicy<LaterDeadline, true> {
+    static constexpr const char *NAME = "EDF";
+    using PriorityPolicy::PriorityPolicy;
+};
+
+struct CFSPolicy : PolicyBase {
+    static constexpr const char *NAME = "CFS";
+    static constexpr bool PREEMPTIVE = true;
+
+    const CFSParams &params;
+    CFSRunQueue tree;
+    long long queued_weight = 0;   // Sum of the weights of the processes in tree
+    long long min_vruntime = 0;    // Monotonic floor of the vruntimes in the run queue
+
+    explicit CFSPolicy(const SimConfig &config) : params(config.cfs) {}
+
+    bool empty() const { return tree.empty(); }
+    int size() const { return tree.size(); }
+
+    // New arrivals start at min_vruntime so they neither starve nor get starved. Processes
+    // waking from I/O keep their vruntime but get at most half a latency period of credit.
+    void enqueue(Process *process) {
+        if (process->current_burst == 0) process->vruntime = min_vruntime;
+        else process->vruntime = max(process->vruntime, min_vruntime - vruntimeDelta(params.sched_latency / 2, NICE_0_WEIGHT));
+        requeue(process);
+    }
+
+    void requeue(Process *process) {
+        tree.insert(process);
+        queued_weight += process->weight;
+    }
+
+    Process *pick() {
+        Process *process = tree.first();
+        tree.erase(process);
+        queued_weight -= process->weight;
+        return process;
+    }
+
+    // A newly ready process preempts once it is far enough behind the running one
+    bool shouldPreempt(const Process *running) const {
+        return !tree.empty() &&
+               running->vruntime - tree.first()->vruntime > vruntimeDelta(params.wakeup_granularity, tree.first()->weight);
+    }
+
+    int slice(const Process *running) const {
+        return cfsSlice(params, tree.size() + 1, queued_weight + running->weight, running->weight);
+    }
+
+    void charge(Process *running, int run_time) {
+        running->vruntime += vruntimeDelta(run_time, running->weight);
+        long long leftmost_vruntime = tree.empty() ? running->vruntime : min(running->vruntime, tree.first()->vruntime);
+        min_vruntime = max(min_vruntime, leftmost_vruntime);
+    }
+
+    // A migrating process keeps its lag behind min_vruntime rather than its absolute vruntime
+    Process *detach() {
+        Process *process = pick();
+        process->vruntime -= min_vruntime;
+        return process;
+    }
+
+    void attach(Process *process) {
+        process->vruntime += min_vruntime;
+        requeue(process);
+    }
+};
+
+// Multi-level feedback queue as in OSTEP: arrivals start at the top level, a process that
+// uses up the quantum of its level moves one level down, and every boost interval all
+// processes return to the top. Time used at a level adds up across slices, so yielding just
+// before the quantum runs out does not keep a process up. Each level is a ProcessQueue and a
+// bitmask marks the non-empty ones, so every operation is O(1) and a boost just splices the
+// queues; processes learn they were boosted when they are next touched.
+struct MLFQPolicy : PolicyBase {
+    static constexpr const char *NAME = "MLFQ";
+    static constexpr bool PREEMPTIVE = true;
+
+    const MLFQParams &params;
+    int levels;
+    ProcessQueue queues[32];
+    uint32_t nonempty = 0;   // Bit i is set when level i has queued processes
+    int count = 0;
+    long long epoch = 0;     // Boosts so far, as now / boost_interval
+
+    explicit MLFQPolicy(const SimConfig &config)
+        : params(config.mlfq), levels(min(max(config.mlfq.levels, 1), 32)) {}
+
+    bool empty() const { return count == 0; }
+    int size() const { return count; }
+
+    void enqueue(Process *process) {
+        if (process->current_burst == 0) {
+            process->level = 0;
+            process->level_time = 0;
+            process->boost_epoch = epoch;
+        }
+        requeue(process);
+    }
+
+    // A process that used up its quantum moves down a level; one that was preempted stays
+    void requeue(Process *process) {
+        refresh(process);
+        if (process->level_time >= quantum(process->level)) {
+            process->level = min(process->level + 1, levels - 1);
+            process->level_time = 0;
+        }
+        push(process);
+    }
+
+    Process *pick() {
+        int level = __builtin_ctz(nonempty);
+        Process *process = queues[level].pop();
+        if (queues[level].empty()) nonempty &= ~(1u << level);
+        count--;
+        refresh(process);
+        return process;
+    }
+
+    bool shouldPreempt(const Process *running) const {
+        return nonempty != 0 && __builtin_ctz(nonempty) < running->level;
+    }
+
+    int slice(const Process *running) const { return max(quantum(running->level) - running->level_time, 1); }
+
+    void charge(Process *running, int run_time) {
+        refresh(running);
+        running->level_time += run_time;
+    }
+
+    long long nextTimer() const { return params.boost_interval > 0 ? (epoch + 1) * params.boost_interval : LLONG_MAX; }
+
+    // Boost: every level joins the end of the top one
+    void timer(long long now) {
+        epoch = now / params.boost_interval;
+        for (int level = 1; level < levels; level++) queues[0].splice(queues[level]);
+        if (nonempty) nonempty = 1;
+    }
+
+    Process *detach() { return pick(); }
+    void attach(Process *process) { push(process); }
+
+private:
+    int quantum(int level) const { return (int)min((long long)max(params.quantum, 1) << level, (long long)INT_MAX); }
+
+    // Moves a process that has not been touched since a boost back to the top level
+    void refresh(Process *process) const {
+        if (process->boost_epoch == epoch) return;
+        process->level = 0;
+        process->level_time = 0;
+        process->boost_epoch = epoch;
+    }
+
+    void push(Process *process) {
+        refresh(process);
+        queues[process->level].push(process);
+        nonempty |= 1u << process->level;
+        count++;
+    }
+};
+
+// EEVDF, the fair scheduler of Linux since 6.6. Every process asks for requests of
+// eevdf_slice time units; a request's virtual deadline is its vruntime plus the slice scaled
+// by the process's weight. A process is eligible when its vruntime is at most the
+// weight-averaged vruntime V of the run queue, i.e. the CPU owes it time, and the eligible
+// process with the earliest virtual deadline runs. The run queue is ordered by vruntime and
+// every subtree knows its earliest deadline, so that process is found in O(log n). Like the
+// kernel, V counts the running process, and a process that blocks or migrates keeps its lag
+// V - vruntime (bounded by two slices) and is placed back at V - lag.
+struct EEVDFPolicy : PolicyBase {
+    static constexpr const char *NAME = "EEVDF";
+    static constexpr bool PREEMPTIVE = true;
+
+    int request;
+    EEVDFRunQueue tree;
+    // V = zero + weighted_sum / total_weight, where weighted_sum is the sum of
+    // (vruntime - zero) * weight over the queued and running processes. zero follows the
+    // smallest vruntime so the sum stays small.
+    long long zero = 0;
+    long long weighted_sum = 0;
+    long long total_weight = 0;
+
+    explicit EEVDFPolicy(const SimConfig &config) : request(max(config.eevdf_slice, 1)) {}
+
+    bool empty() const { return tree.empty(); }
+    int size() const { return tree.size(); }
+
+    // Arrivals have no lag, so they start at V
+    void enqueue(Process *process) {
+        process->vruntime = averageVruntime() - process->lag;
+        process->virtual_deadline = process->vruntime + vruntimeDelta(request, process->weight);
+        join(process);
+        tree.insert(process);
+    }
+
+    // The running process is still counted in V; a finished request gets a new deadline
+    void requeue(Process *process) {
+        if (process->vruntime >= process->virtual_deadline) {
+            process->virtual_deadline = process->vruntime + vruntimeDelta(request, process->weight);
+        }
+        tree.insert(process);
+    }
+
+    Process *pick() {
+        Process *process = earliestEligible();
+        tree.erase(process);
+        return process;
+    }
+
+    // The running process yields once it is no longer eligible or an eligible process has an
+    // earlier deadline. earliestEligible falls back to a process that is not eligible, which
+    // must not take the CPU on its deadline alone.
+    bool shouldPreempt(const Process *running) const {
+        if (tree.empty()) return false;
+        if (!eligible(running)) return true;
+        const Process *candidate = earliestEligible();
+        if (!eligible(candidate)) return false;
+        return candidate->virtual_deadline < running->virtual_deadline;
+    }
+
+    // Time until the running process reaches its virtual deadline
+    int slice(const Process *running) const {
+        long long delta = running->virtual_deadline - running->vruntime;
+        return (int)max((delta * running->weight + (1 << 20) - 1) >> 20, 1LL);
+    }
+
+    void charge(Process *running, int run_time) {
+        long long delta = vruntimeDelta(run_time, running->weight);
+        running->vruntime += delta;
+        weighted_sum += delta * running->weight;
+        long long smallest = tree.empty() ? running->vruntime : min(running->vruntime, tree.first()->vruntime);
+        if (smallest > zero) {
+            weighted_sum -= (smallest - zero) * total_weight;
+            zero = smallest;
+        }
+    }
+
+    void retire(Process *running) {
+        running->lag = clampLag(running, averageVruntime() - running->vruntime);
+        leave(running);
+    }
+
+    // A migrating process takes its lag and the rest of its request along
+    Process *detach() {
+        Process *process = pick();
+        process->lag = clampLag(process, averageVruntime() - process->vruntime);
+        process->virtual_deadline -= process->vruntime;
+        leave(process);
+        return process;
+    }
+
+    void attach(Process *process) {
+        process->vruntime = averageVruntime() - process->lag;
+        process->virtual_deadline += process->vruntime;
+        join(process);
+        tree.insert(process);
+    }
+
+private:
+    long long averageVruntime() const { return total_weight == 0 ? zero : zero + weighted_sum / total_weight; }
+
+    // vruntime <= V, without the rounding of V
+    bool eligible(const Process *process) const {
+        return (process->vruntime - zero) * total_weight <= weighted_sum;
+    }
+
+    long long clampLag(const Process *process, long long lag) const {
+        long long limit = vruntimeDelta(2 * request, process->weight);
+        return min(max(lag, -limit), limit);
+    }
+
+    void join(Process *process) {
+        weighted_sum += (process->vruntime - zero) * process->weight;
+        total_weight += process->weight;
+    }
+
+    void leave(Process *process) {
+        weighted_sum -= (process->vruntime - zero) * process->weight;
+        total_weight -= process->weight;
+    }
+
+    // Eligible processes are a prefix of the tree in vruntime order: walking down, a node that
+    // is eligible makes its whole left subtree eligible, so the best candidate is either such
+    // a subtree, found through its earliest deadline, or an eligible node on the path
+    Process *earliestEligible() const {
+        Process *best = nullptr;
+        long long best_deadline = LLONG_MAX;
+        for (Process *node = tree.top(); node;) {
+            if (!eligible(node)) {
+                node = node->run_node.left;
+                continue;
+            }
+            Process *left = node->run_node.left;
+            if (left && left->min_virtual_deadline < best_deadline) {
+                best = left;
+                best_deadline = left->min_virtual_deadline;
+            }
+            if (node->virtual_deadline < best_deadline) {
+                best = node;
+                best_deadline = node->virtual_deadline;
+            }
+            node = node->run_node.right;
+        }
+        // Rounding can leave nothing eligible; fall back to the smallest vruntime
+        if (!best) return tree.first();
+        while (best->virtual_deadline != best_deadline) {
+            Process *left = best->run_node.left;
+            best = left && left->min_virtual_deadline == best_deadline ? left : best->run_node.right;
+        }
+        return best;
+    }
+};
+
+template <typename Policy>
+struct PolicyTag {
+    using type = Policy;
+};
+
+// Calls `visit` with the PolicyTag of the policy behind an algorithm name as given on the
+// command line; returns false for an unknown name. A new policy only needs a line here to
+// become available to every simulator front end.
+template <typename Visit>
+bool visitPolicy(const string &algorithm, Visit visit) {
+    if (algorithm == "FIFO") {
+        visit(PolicyTag<FIFOPolicy>());
+    } else if (algorithm == "SJF") {
+        visit(PolicyTag<SJFPolicy>());
+    } else if (algorithm == "SJF-Preemptive") {
+        visit(PolicyTag<PreemptiveSJFPolicy>());
+    } else if (algorithm == "CFS") {
+        visit(PolicyTag<CFSPolicy>());
+    } else if (algorithm == "RR") {
+        visit(PolicyTag<RoundRobinPolicy>());
+    } else if (algorithm == "MLFQ") {
+        visit(PolicyTag<MLFQPolicy>());
+    } else if (algorithm == "EEVDF") {
+        visit(PolicyTag<EEVDFPolicy>());
+    } else if (algorithm == "EDF") {
+        visit(PolicyTag<EDFPolicy>());
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Topologies. MULTI_CORE lets the simulator compile placement, balancing and stealing out of
+// single-core runs.
+
+struct UniCore {
+    static constexpr bool MULTI_CORE = false;
+    int cores() const { return 1; }
+};
+
+// Several cores on one timeline. Arrivals and wake-ups are placed on a core by the placement
+// policy; with work stealing a core that runs dry takes the next process of the longest run
+// queue, and the periodic balancer evens out run queue lengths. Processes block on the devices
+// of the core they ran on.
+struct MultiCore {
+    static constexpr bool MULTI_CORE = true;
+    SMPConfig smp;
+    int cores() const { return smp.cores; }
+};
+
+// One simulated core: its policy, the process on it and its I/O devices
+template <typename Policy>
+struct Core {
+    Policy run_queue;
+    IODevices devices;
+    Process *running = nullptr;
+    long long since = 0;        // Time up to which the running process has been charged
+    int overhead = 0;           // Switching time the core still loses from `since` before the process runs
+    int slice = 0;              // Time the running process may still use once the overhead is paid
+    int last_process = -1;      // Id of the process the core ran last
+    long long segment_end = LLONG_MAX;   // When the running process finishes its burst or slice
+    long long current_time = 0;          // Time of the last completion on this core
+    RunMetrics metrics;
+    SimCounters counters;       // Run queue counters of this core
+
+    explicit Core(const SimConfig &config) : run_queue(config), devices(config.io_devices) {}
+
+    int load() const { return run_queue.size() + (running ? 1 : 0); }
+    bool idle() const { return !running && run_queue.empty() && devices.empty(); }
+};
+
+// State of a run between two events, enough to continue it. Processes that completed only
+// live on in the metrics and processes still to arrive are in their initial state, so only
+// the processes in the system are copied; everything else points at them.
+template <typename Policy>
+struct Checkpoint {
+    long long time;               // The run continues with the events at this time
+    size_t next_arrival;          // Processes admitted so far, in arrival order
+    long long next_balance;
+    SimCounters counters;
+    vector<Core<Policy>> cores;
+    vector<Process> live;
+};
+
+// Discrete-event simulation of `Policy` on the cores of `Topology`. Time jumps from one event
+// to the next: an arrival, an I/O completion, the end of a burst or slice, a policy timer or a
+// balancing tick.
+template <typename Policy, typename Topology>
+class Simulator {
+public:
+    SimCounters counters;
+
+    Simulator(const SimConfig &config, const Topology &topology) : config(config), topology(topology) {
+        cores.reserve(topology.cores());
+        for (int i = 0; i < topology.cores(); i++) cores.emplace_back(config);
+    }
+
+    // Known at compile time for a single core, so the per-core loops disappear
+    int coreCount() const { return Topology::MULTI_CORE ? cores.size() : 1; }
+    const RunMetrics &metrics(int core) const { return cores[core].metrics; }
+    long long lastCompletion(int core) const { return cores[core].current_time; }
+
+    RunMetrics totalMetrics() const {
+        RunMetrics total;
+        for (const auto &core : cores) total.merge(core.metrics);
+        return total;
+    }
+
+    // Counters of one core, with the span of the run so its average queue depth is known.
+    // A run only ends once its run queues are empty, so every process put on a queue was
+    // taken off it again: the queue operations are twice the picks, plus twice the processes
+    // that migrated away, counted as they go.
+    SimCounters coreCounters(int core) const {
+        SimCounters result = cores[core].counters;
+        result.queue_operations += 2 * result.decisions;
+        result.end_time = counters.end_time;
+        return result;
+    }
+
+    SimCounters totalCounters() const {
+        SimCounters total = counters;
+        for (int i = 0; i < (int)cores.size(); i++) total.merge(coreCounters(i));
+        return total;
+    }
+
+    // Makes runs over a ProcessArray<Process> save a checkpoint at the first event of every
+    // `interval` time units
+    void enableCheckpoints(int interval) { checkpoint_interval = interval; }
+    const vector<Checkpoint<Policy>> &checkpoints() const { return saved; }
+
+    // Latest checkpoint from which the events at `time` and after are still to be simulated,
+    // null if there is none
+    const Checkpoint<Policy> *checkpointBefore(long long time) const {
+        auto after = upper_bound(saved.begin(), saved.end(), time,
+                                 [](long long t, const Checkpoint<Policy> &checkpoint) { return t < checkpoint.time; });
+        return after == saved.begin() ? nullptr : &*(after - 1);
+    }
+
+    // Runs every process of the arrival source to completion. The source hands out processes
+    // in arrival order (see ProcessArray and ProcessStream) and gets them back once they finish.
+    template <typename Arrivals>
+    void run(Arrivals &arrivals) {
+        next_balance = balanceInterval() > 0 ? balanceInterval() : LLONG_MAX;
+        // With the number of processes known, every core's run queue is sized for its share
+        if (size_t processes = knownSize(arrivals)) {
+            for (auto &core : cores) core.run_queue.reserve((processes + cores.size() - 1) / cores.size());
+        }
+        loop(arrivals);
+    }
+
+    // Continues a run from a checkpoint. The processes before checkpoint.next_arrival must be
+    // those of the checkpointed run, at the same addresses; the ones after it may differ and
+    // are simulated from their initial state. Runs of several simulators may resume from the
+    // same checkpoint.
+    void resume(const Checkpoint<Policy> &checkpoint, vector<Process> &processes) {
+        // Policies hold references to the config, so the cores are copied rather than assigned
+        cores.clear();
+        for (const Core<Policy> &core : checkpoint.cores) cores.push_back(core);
+        counters = checkpoint.counters;
+        next_balance = checkpoint.next_balance;
+        live.clear();
+        for (const Process &process : checkpoint.live) {
+            processes[process.slot] = process;
+            live.push_back(&processes[process.slot]);
+        }
+        ProcessArray<Process> arrivals(processes);
+        arrivals.next_arrival = checkpoint.next_arrival;
+        loop(arrivals);
+    }
+
+private:
+    const SimConfig &config;
+    Topology topology;
+    vector<Core<Policy>> cores;
+    long long next_balance = LLONG_MAX;
+    long long sample_end = 0;     // When the last sampled event was handled
+
+    int checkpoint_interval = 0;
+    vector<Checkpoint<Policy>> saved;
+    vector<Process*> live;        // Processes in the system, kept only while checkpointing
+
+    template <typename Element>
+    static size_t knownSize(const ProcessArray<Element> &arrivals) { return arrivals.processes.size(); }
+    template <typename Arrivals>
+    static size_t knownSize(const Arrivals &) { return 0; }
+
+    template <typename Arrivals>
+    void loop(Arrivals &arrivals) {
+        // A single core whose policy never preempts only needs to stop when its burst ends;
+        // what became ready meanwhile is queued then, in the order it became ready
+        constexpr bool HOLD_WHILE_RUNNING = !Topology::MULTI_CORE && !Policy::PREEMPTIVE;
+
+        int core_count = coreCount();
+        long long next_checkpoint = 0;
+        long long allocations_before = thread_allocations;
+        long long loop_start = phaseClock();
+        sample_end = 0;
+        long long now = counters.end_time;   // Zero unless resuming from a checkpoint
+
+        while (true) {
+            // Next point in time where anything can change
+            long long next = LLONG_MAX;
+            bool busy = arrivals.pending();
+            bool queued = false;
+            bool running = false;
+            for (int i = 0; i < core_count; i++) {
+                Core<Policy> &core = cores[i];
+                next = min(next, core.segment_end);
+                running = running || core.running;
+                if (!(HOLD_WHILE_RUNNING && core.running)) next = min(next, core.devices.nextWakeupTime());
+                if (!core.idle()) next = min(next, core.run_queue.nextTimer());
+                busy = busy || !core.idle();
+                queued = queued || !core.run_queue.empty();
+            }
+            if (!(HOLD_WHILE_RUNNING && cores[0].running)) next = min(next, arrivals.nextArrivalTime());
+            if (!busy) break;
+            if (queued && next_balance < next) next = next_balance;
+            // Windows close only once `next` is final, so none ends past an event inside it
+            if (config.windows) {
+                int queued_processes = 0;
+                for (int i = 0; i < core_count; i++) queued_processes += cores[i].run_queue.size();
+                config.windows->advance(next, queued_processes);
+            }
+            if constexpr (is_same<Arrivals, ProcessArray<Process>>::value) {
+                if (checkpoint_interval > 0 && next >= next_checkpoint) {
+                    counters.end_time = now;
+                    save(next, arrivals);
+                    next_checkpoint = (next / checkpoint_interval + 1) * checkpoint_interval;
+                }
+            }
+            counters.events++;
+            counters.idle_skips += !running & (next > now);
+            for (int i = 0; i < core_count; i++) {
+                SimCounters &core_counters = cores[i].counters;
+                int depth = cores[i].run_queue.size();
+                core_counters.queue_depth_time += depth * (next - now);
+                core_counters.peak_queue_depth = max(core_counters.peak_queue_depth, depth);
+            }
+            now = next;
+            if (balanceInterval() > 0 && next_balance < now) {
+                next_balance += (now - next_balance + balanceInterval() - 1) / balanceInterval() * balanceInterval();
+            }
+
+            // A sampled event times its phases, and the one after it how long finding it took
+            long long sample = counters.events & (PHASE_SAMPLE_EVENTS - 1);
+            if (sample > 1) {
+                handleEvents<false>(now, arrivals);
+            } else if (sample == 0) {
+                handleEvents<true>(now, arrivals);
+            } else {
+                if (sample_end > 0) counters.sampled_next_ns += max(phaseClock() - sample_end - phaseClockOverhead(), 0LL);
+                handleEvents<false>(now, arrivals);
+            }
+        }
+        counters.end_time = now;
+        counters.loop_ns += phaseClock() - loop_start;
+        counters.allocations += thread_allocations - allocations_before;
+    }
+
+    // Handles everything that happens at `now`: bursts and slices that end, policy timers,
+    // arrivals and wake-ups, balancing and dispatching. TIMED adds the phases to the samples.
+    template <bool TIMED, typename Arrivals>
+    void handleEvents(long long now, Arrivals &arrivals) {
+        int core_count = coreCount();
+        long long account_start = TIMED ? phaseClock() : 0;
+        for (int i = 0; i < core_count; i++) {
+            if (cores[i].running && cores[i].segment_end == now) settle(i, now, arrivals);
+        }
+
+        for (int i = 0; i < core_count; i++) {
+            if (cores[i].run_queue.nextTimer() <= now) {
+                settle(i, now, arrivals);
+                cores[i].run_queue.timer(now);
+            }
+        }
+
+        long long admit_start = TIMED ? phaseClock() : 0;
+        placeReady(arrivals, now);
+
+        long long select_start = TIMED ? phaseClock() : 0;
+        if (now == next_balance) {
+            balance(now, arrivals);
+            next_balance += balanceInterval();
+        }
+
+        for (int i = 0; i < core_count; i++) dispatch(i, now, arrivals);
+
+        // Cores left without work steal the next process of the longest run queue
+        if constexpr (Topology::MULTI_CORE) {
+            if (topology.smp.work_stealing) {
+                for (int i = 0; i < core_count; i++) {
+                    if (cores[i].running) continue;
+                    int victim = loadExtreme(true, true);
+                    if (cores[victim].run_queue.empty()) break;
+                    migrate(victim, i, now, arrivals);
+                    dispatch(i, now, arrivals);
+                }
+            }
+        }
+
+        if constexpr (TIMED) {
+            long long select_end = phaseClock();
+            long long overhead = phaseClockOverhead();
+            counters.sampled_account_ns += max(admit_start - account_start - overhead, 0LL);
+            counters.sampled_admit_ns += max(select_start - admit_start - overhead, 0LL);
+            counters.sampled_select_ns += max(select_end - select_start - overhead, 0LL);
+            sample_end = phaseClock();
+        }
+    }
+
+    void save(long long time, const ProcessArray<Process> &arrivals) {
+        Checkpoint<Policy> checkpoint{time, arrivals.next_arrival, next_balance, counters, cores, {}};
+        checkpoint.live.reserve(live.size());
+        for (const Process *process : live) checkpoint.live.push_back(*process);
+        saved.push_back(move(checkpoint));
+    }
+
+    int balanceInterval() const {
+        if constexpr (Topology::MULTI_CORE) return topology.smp.balance_interval;
+        return 0;
+    }
+
+    // Charges the running process of a core for the time since it was last charged, after
+    // the switching overhead, then retires it if its burst or slice has run out
+    template <typename Arrivals>
+    void settle(int index, long long now, Arrivals &arrivals) {
+        Core<Policy> &core = cores[index];
+        Process *process = core.running;
+        if (!process) return;
+        // Nothing to charge, unless the burst is empty and has to be retired right away
+        if (now == core.since && process->remaining_time > 0 && core.slice > 0) return;
+
+        long long elapsed = now - core.since;
+        int lost = (int)min(elapsed, (long long)core.overhead);
+        int run_time = (int)(elapsed - lost);
+        core.overhead -= lost;
+        core.metrics.overhead_time += lost;
+        process->remaining_time -= run_time;
+        process->last_ran = now;
+        core.slice -= run_time;
+        core.since = now;
+        core.run_queue.charge(process, run_time);
+
+        if (process->remaining_time == 0) {
+            core.running = nullptr;
+            core.segment_end = LLONG_MAX;
+            core.run_queue.retire(process);
+            if (hasNextBurst(*process)) {
+                traceEvent(config.trace, index, TraceEventType::Block, now, process->id);
+                core.devices.block(process, now);
+                return;
+            }
+            process->turnaround_time = now - process->arrival_time;
+            process->completion_time = now;
+            traceEvent(config.trace, index, TraceEventType::Complete, now, process->id);
+            core.metrics.record(*process);
+            if (config.windows) config.windows->completed(*process);
+            core.current_time = now;
+            if (checkpoint_interval > 0) {
+                live[process->live_index] = live.back();
+                live[process->live_index]->live_index = process->live_index;
+                live.pop_back();
+            }
+            arrivals.release(process);
+        } else if (core.slice == 0) {
+            process->state_since = now;
+            traceEvent(config.trace, index, TraceEventType::Preempt, now, process->id);
+            core.run_queue.requeue(process);
+            core.counters.preemptions++;
+            core.running = nullptr;
+            core.segment_end = LLONG_MAX;
+        }
+    }
+
+    // Core holding the most (longest) or fewest (!longest) processes, lowest index on ties
+    int loadExtreme(bool longest, bool queued_only) const {
+        int best = 0;
+        for (int i = 1; i < (int)cores.size(); i++) {
+            int load = queued_only ? cores[i].run_queue.size() : cores[i].load();
+            int best_load = queued_only ? cores[best].run_queue.size() : cores[best].load();
+            if (longest ? load > best_load : load < best_load) best = i;
+        }
+        return best;
+    }
+
+    // Moves the next queued process of one core to another
+    template <typename Arrivals>
+    void migrate(int from, int to, long long now, Arrivals &arrivals) {
+        settle(to, now, arrivals);
+        cores[to].run_queue.attach(cores[from].run_queue.detach());
+        cores[from].counters.queue_operations += 2;
+    }
+
+    // Places every process that became ready by `now`, arrivals first and then wake-ups by core
+    template <typename Arrivals>
+    void placeReady(Arrivals &arrivals, long long now) {
+        while (true) {
+            long long arrival = arrivals.nextArrivalTime();
+            int waking_core = 0;
+            if constexpr (Topology::MULTI_CORE) {
+                for (int i = 1; i < (int)cores.size(); i++) {
+                    if (cores[i].devices.nextWakeupTime() < cores[waking_core].devices.nextWakeupTime()) waking_core = i;
+                }
+            }
+            long long wakeup = cores[waking_core].devices.nextWakeupTime();
+            if (min(arrival, wakeup) > now) break;
+
+            Process *process;
+            int target = 0;
+            if (arrival <= wakeup) {
+                process = arrivals.admit();
+                process->state_since = arrival;
+                if (checkpoint_interval > 0) {
+                    process->live_index = live.size();
+                    live.push_back(process);
+                }
+                if constexpr (Topology::MULTI_CORE) {
+                    target = process->id % cores.size();
+                    if (topology.smp.placement == Placement::LeastLoaded) target = loadExtreme(false, false);
+                }
+            } else {
+                process = cores[waking_core].devices.wake();
+                if constexpr (Topology::MULTI_CORE) {
+                    target = process->id % cores.size();
+                    if (topology.smp.placement == Placement::LeastLoaded) {
+                        // Stay on the core the process last ran on unless another one is less loaded
+                        target = loadExtreme(false, false);
+                        if (cores[waking_core].load() == cores[target].load()) target = waking_core;
+                    }
+                }
+                traceEvent(config.trace, target, TraceEventType::Wake, wakeup, process->id);
+            }
+            settle(target, now, arrivals);
+            cores[target].run_queue.enqueue(process);
+        }
+    }
+
+    // Migrates queued processes from the busiest to the idlest core until their loads differ
+    // by at most one
+    template <typename Arrivals>
+    void balance(long long now, Arrivals &arrivals) {
+        while (true) {
+            int busiest = loadExtreme(true, false);
+            int idlest = loadExtreme(false, false);
+            if (cores[busiest].load() - cores[idlest].load() <= 1 || cores[busiest].run_queue.empty()) break;
+            migrate(busiest, idlest, now, arrivals);
+        }
+    }
+
+    // CPU time a core loses before `process` makes progress on it: nothing if the core ran
+    // it last, otherwise a context switch and refilling the caches. Whatever the process had
+    // in this core's cache decays while it is away; after a migration it has nothing.
+    int switchCost(int index, Process &process, long long now) {
+        Core<Policy> &core = cores[index];
+        if (core.last_process == process.id) return 0;
+        const SwitchCosts &costs = config.switching;
+        core.last_process = process.id;
+        core.metrics.context_switches++;
+        int cost = costs.context_switch;
+        if (process.last_core >= 0 && process.last_core != index) {
+            core.metrics.migrations++;
+            cost += costs.migration + costs.cache_refill;
+        } else if (process.last_core == index && costs.cache_refill > 0) {
+            double warm = costs.cache_half_life > 0 ? exp2(-(double)(now - process.last_ran) / costs.cache_half_life) : 0;
+            cost += (int)lround(costs.cache_refill * (1 - warm));
+        }
+        process.last_core = index;
+        return cost;
+    }
+
+    // Preempts or picks on a core; a zero-length segment is left for the next pass at `now`
+    template <typename Arrivals>
+    void dispatch(int index, long long now, Arrivals &arrivals) {
+        Core<Policy> &core = cores[index];
+        Process *process = core.running;
+        if (Policy::PREEMPTIVE && process && core.run_queue.shouldPreempt(process)) {
+            // The core may not have been settled at `now` if only its run queue changed
+            settle(index, now, arrivals);
+            if (core.running) {
+                process->state_since = now;
+                traceEvent(config.trace, index, TraceEventType::Preempt, now, process->id);
+                core.run_queue.requeue(process);
+                core.counters.preemptions++;
+                core.running = nullptr;
+            }
+        }
+        if (!core.running) {
+            if (core.run_queue.empty()) return;
+            process = core.run_queue.pick();
+            startRunning(*process, now);
+            traceEvent(config.trace, index, TraceEventType::Dispatch, now, process->id);
+            core.counters.decisions++;
+            core.running = process;
+            core.since = now;
+            core.slice = core.run_queue.slice(process);
+            core.overhead = switchCost(index, *process, now);
+        }
+        core.segment_end = core.since + core.overhead + min(core.running->remaining_time, core.slice);
+    }
+};
+
+#endif // SIMULATOR_H
@@ -0,0 +1,114 @@
+// Trace.h
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Events kept per core when tracing; older ones are overwritten
+const int DEFAULT_TRACE_EVENTS = 1 << 20;
+
+enum class TraceEventType : uint8_t {
+    Dispatch,   // The process got the CPU
+    Preempt,    // The process lost the CPU before its burst ended
+    Block,      // The process finished a CPU burst and blocked for I/O
+    Wake,       // The process finished an I/O burst and became ready
+    Complete    // The process finished its last CPU burst
+};
+
+// One traced event, stored as is in the trace file
+struct TraceEvent {
+    int64_t time;
+    int32_t process;   // Process id
+    uint16_t core;
+    TraceEventType type;
+    uint8_t reserved;
+};
+
+// The most recent events of one core in a buffer allocated up front. The capacity is a power
+// of two so wrapping is a mask; once the buffer is full the oldest events are overwritten.
+class TraceRing {
+public:
+    explicit TraceRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        events.resize(size);
+        mask = size - 1;
+    }
+
+    void push(const TraceEvent &event) { events[written++ & mask] = event; }
+
+    size_t size() const { return written < events.size() ? written : events.size(); }
+    uint64_t dropped() const { return written - size(); }
+
+    // Event `i` of the retained ones, oldest first
+    const TraceEvent &operator[](size_t i) const { return events[(written - size() + i) & mask]; }
+
+private:
+    vector<TraceEvent> events;
+    size_t mask = 0;
+    uint64_t written = 0;
+};
+
+// Binary trace format, version 2, little-endian: the header, then for every core a uint64
+// count of dropped events, a uint64 count of retained events and the retained TraceEvents,
+// oldest first.
+const char TRACE_MAGIC[8] = {'S', 'C', 'H', 'E', 'D', 'T', 'R', '\0'};
+const uint32_t TRACE_VERSION = 2;
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t cores;
+};
+
+// Per-core event rings of one run. A core only ever writes its own ring, and all the memory
+// is allocated when tracing is switched on, so recording is a store and an increment.
+class Tracer {
+public:
+    vector<TraceRing> rings;
+
+    Tracer(int cores, size_t events_per_core) : rings(cores, TraceRing(events_per_core)) {}
+
+    void record(int core, TraceEventType type, long long time, int process) {
+        rings[core].push({time, process, (uint16_t)core, type, 0});
+    }
+
+    // Writes the trace; returns false if the file cannot be written
+    bool write(const string &file_path) const {
+        ofstream out(file_path, ios::binary | ios::trunc);
+        TraceHeader header;
+        memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+        header.version = TRACE_VERSION;
+        header.cores = rings.size();
+        out.write((const char *)&header, sizeof(header));
+        for (const TraceRing &ring : rings) {
+            uint64_t counts[2] = {ring.dropped(), ring.size()};
+            out.write((const char *)counts, sizeof(counts));
+            for (size_t i = 0; i < ring.size(); i++) out.write((const char *)&ring[i], sizeof(TraceEvent));
+        }
+        return (bool)out;
+    }
+};
+
+// Records an event if the run is traced; with tracing off this is a single branch
+inline void traceEvent(Tracer *trace, int core, TraceEventType type, long long time, int process) {
+    if (trace) trace->record(core, type, time, process);
+}
+
+// Writes the trace of a run if it was traced, for the exit status of a simulator
+inline int writeTrace(const Tracer *tracer, const string &file_path) {
+    if (tracer && !tracer->write(file_path)) {
+        cerr << "Could not write trace file: " << file_path << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+#endif // TRACE_H
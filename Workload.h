@@ -0,0 +1,541 @@
+// Workload.h
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include "Scheduler.h"
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Files smaller than this are parsed on the calling thread
+const size_t PARALLEL_PARSE_MIN_BYTES = 1 << 22;
+
+// Streaming reads the workload in blocks of this size and keeps at most this many parsed
+// chunks waiting for the simulator
+const size_t STREAM_READ_BYTES = 1 << 20;
+const size_t STREAM_QUEUE_CHUNKS = 2;
+
+// Read-only memory mapping of a whole file. `data` stays null if the file cannot be mapped
+// (missing, empty, or not a regular file).
+struct MappedFile {
+    const char *data = nullptr;
+    size_t size = 0;
+
+    explicit MappedFile(const string &path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+                data = (const char *)mapping;
+                size = info.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data) munmap((void *)data, size);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+};
+
+// Reads an optionally signed decimal int at p, skipping blanks but never a newline. Accepts
+// exactly what `istream >> int` accepts; on failure p is left on the offending byte so every
+// later read on the same line fails too, like a stream with failbit set.
+inline bool scanInt(const char *&p, const char *end, int &value) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f')) p++;
+
+    const char *start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    const char *digits = p;
+    unsigned long long magnitude = 0;
+    while (p < end && (unsigned char)(*p - '0') < 10) {
+        if (magnitude <= INT_MAX + 1ULL) magnitude = magnitude * 10 + (*p - '0');
+        p++;
+    }
+
+    if (p == digits || magnitude > (negative ? INT_MAX + 1ULL : (unsigned long long)INT_MAX)) {
+        p = start;
+        return false;
+    }
+    value = negative ? (int)-(long long)magnitude : (int)magnitude;
+    return true;
+}
+
+// Parses the lines in [begin, end) into `workload` with the same rules as parseWorkloadStream,
+// numbering processes from 0 in line order
+inline void parseWorkloadLines(const char *begin, const char *end, Workload &workload) {
+    const char *p = begin;
+    int arrival_time, burst, nice, deadline;
+    int process_id = 0;
+
+    while (p < end) {
+        const char *line_end = (const char *)memchr(p, '\n', end - p);
+        if (!line_end) line_end = end;
+
+        if (scanInt(p, line_end, arrival_time)) {
+            while (scanInt(p, line_end, burst) && burst != -1) {
+                workload.bursts.push_back(burst);
+
+                if (!scanInt(p, line_end, burst) || burst == -1) break;
+                workload.bursts.push_back(burst);
+            }
+
+            if (!scanInt(p, line_end, nice)) nice = 0;
+            if (!scanInt(p, line_end, deadline)) deadline = NO_DEADLINE;
+
+            workload.addProcess(process_id++, arrival_time, nice, deadline);
+        }
+
+        p = line_end + 1;
+    }
+}
+
+// Binary workload format, version 2. All integers are little-endian and every section starts
+// on an 8-byte boundary. After the header come the columns
+//   int32  id[n], arrival_time[n], deadline[n]  (version 1 files have no deadline column)
+//   int8   nice[n]
+//   uint64 burst_offset[n + 1]                  index of each process's first burst
+//   uint64 block_payload_offset[blocks + 1]     byte offset of every block_size-th process in the payload
+//   uint8  payload[payload_bytes]               bursts as zigzag varints, in burst order
+// The fixed-width columns are copied straight out of the mapping; only the payload is decoded,
+// one block range per thread, which also recomputes the per-process CPU totals.
+const char BINARY_WORKLOAD_MAGIC[8] = {'S', 'C', 'H', 'E', 'D', 'W', 'L', '\0'};
+const uint32_t BINARY_WORKLOAD_VERSION = 2;
+const uint32_t BINARY_WORKLOAD_BLOCK_SIZE = 4096;
+
+struct BinaryWorkloadHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_size;
+    uint64_t process_count;
+    uint64_t burst_count;
+    uint64_t payload_bytes;
+};
+
+inline size_t alignTo8(size_t size) { return (size + 7) & ~(size_t)7; }
+
+inline void putVarint(vector<uint8_t> &out, int value) {
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    while (zigzag >= 0x80) {
+        out.push_back((uint8_t)(zigzag | 0x80));
+        zigzag >>= 7;
+    }
+    out.push_back((uint8_t)zigzag);
+}
+
+// Decodes one zigzag varint, returning false if it runs past `end`
+inline bool getVarint(const uint8_t *&p, const uint8_t *end, int &value) {
+    uint32_t zigzag = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p == end) return false;
+        uint8_t byte = *p++;
+        zigzag |= (uint32_t)(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            value = (int)(zigzag >> 1) ^ -(int)(zigzag & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Writes the workload in the binary format; returns false if the file cannot be written
+inline bool writeBinaryWorkload(const Workload &workload, const string &file_path) {
+    size_t n = workload.size();
+    uint32_t block_size = BINARY_WORKLOAD_BLOCK_SIZE;
+    size_t blocks = (n + block_size - 1) / block_size;
+
+    vector<uint8_t> payload;
+    vector<uint64_t> block_payload_offset;
+    for (size_t i = 0; i < n; i++) {
+        if (i % block_size == 0) block_payload_offset.push_back(payload.size());
+        for (size_t b = workload.burst_offset[i]; b < workload.burst_offset[i + 1]; b++) putVarint(payload, workload.bursts[b]);
+    }
+    block_payload_offset.push_back(payload.size());
+
+    BinaryWorkloadHeader header;
+    memcpy(header.magic, BINARY_WORKLOAD_MAGIC, sizeof(header.magic));
+    header.version = BINARY_WORKLOAD_VERSION;
+    header.block_size = block_size;
+    header.process_count = n;
+    header.burst_count = workload.bursts.size();
+    header.payload_bytes = payload.size();
+
+    ofstream out(file_path, ios::binary | ios::trunc);
+    const char padding[8] = {};
+    auto writeSection = [&out, &padding](const void *data, size_t bytes) {
+        out.write((const char *)data, bytes);
+        out.write(padding, alignTo8(bytes) - bytes);
+    };
+    // Nice values beyond [-20, 19] weigh the same as its ends (see niceToWeight), so they are
+    // clamped rather than wrapped into the int8 column
+    vector<int8_t> nice(n);
+    for (size_t i = 0; i < n; i++) nice[i] = (int8_t)min(max(workload.nice[i], -20), 19);
+    vector<uint64_t> burst_offset(workload.burst_offset.begin(), workload.burst_offset.end());
+    writeSection(&header, sizeof(header));
+    writeSection(workload.id.data(), n * sizeof(int32_t));
+    writeSection(workload.arrival_time.data(), n * sizeof(int32_t));
+    writeSection(workload.deadline.data(), n * sizeof(int32_t));
+    writeSection(nice.data(), n * sizeof(int8_t));
+    writeSection(burst_offset.data(), (n + 1) * sizeof(uint64_t));
+    writeSection(block_payload_offset.data(), (blocks + 1) * sizeof(uint64_t));
+    writeSection(payload.data(), payload.size());
+    return (bool)out;
+}
+
+inline bool isBinaryWorkload(const char *data, size_t size) {
+    return size >= sizeof(BINARY_WORKLOAD_MAGIC) && memcmp(data, BINARY_WORKLOAD_MAGIC, sizeof(BINARY_WORKLOAD_MAGIC)) == 0;
+}
+
+// Loads a binary workload from a mapped file. Returns false if the file is truncated or its
+// tables are inconsistent.
+inline bool loadBinaryWorkload(const char *data, size_t size, Workload &workload) {
+    BinaryWorkloadHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.version < 1 || header.version > BINARY_WORKLOAD_VERSION || header.block_size == 0) return false;
+    bool has_deadlines = header.version >= 2;
+    if (header.payload_bytes > size || header.burst_count > header.payload_bytes) return false;
+
+    size_t n = header.process_count;
+    size_t blocks = (n + header.block_size - 1) / header.block_size;
+    size_t int_column = alignTo8(n * sizeof(int32_t));
+    size_t expected = alignTo8(sizeof(header)) + (has_deadlines ? 3 : 2) * int_column + alignTo8(n) +
+                      (n + 1) * sizeof(uint64_t) + (blocks + 1) * sizeof(uint64_t) + alignTo8(header.payload_bytes);
+    if (n > size || expected != size) return false;
+
+    const char *p = data + alignTo8(sizeof(header));
+    auto readColumn = [&p](auto &column, size_t count, size_t bytes) {
+        column.resize(count);
+        memcpy(column.data(), p, count * sizeof(column[0]));
+        p += bytes;
+    };
+    vector<int8_t> nice;
+    vector<uint64_t> burst_offset, block_payload_offset;
+    readColumn(workload.id, n, int_column);
+    readColumn(workload.arrival_time, n, int_column);
+    if (has_deadlines) readColumn(workload.deadline, n, int_column);
+    else workload.deadline.assign(n, NO_DEADLINE);
+    readColumn(nice, n, alignTo8(n));
+    readColumn(burst_offset, n + 1, (n + 1) * sizeof(uint64_t));
+    readColumn(block_payload_offset, blocks + 1, (blocks + 1) * sizeof(uint64_t));
+    const uint8_t *payload = (const uint8_t *)p;
+
+    if (burst_offset[0] != 0 || burst_offset[n] != header.burst_count || block_payload_offset[blocks] != header.payload_bytes) return false;
+    for (size_t i = 0; i < n; i++) {
+        if (burst_offset[i] > burst_offset[i + 1]) return false;
+    }
+    for (size_t b = 0; b < blocks; b++) {
+        if (block_payload_offset[b] > block_payload_offset[b + 1]) return false;
+    }
+    workload.nice.assign(nice.begin(), nice.end());
+    workload.burst_offset.assign(burst_offset.begin(), burst_offset.end());
+    workload.bursts.resize(header.burst_count);
+    workload.total_cpu_time.resize(n);
+
+    // Each worker decodes a contiguous range of blocks straight into the burst array
+    auto decodeBlocks = [&](size_t first_block, size_t last_block) {
+        for (size_t b = first_block; b < last_block; b++) {
+            const uint8_t *in = payload + block_payload_offset[b];
+            const uint8_t *in_end = payload + block_payload_offset[b + 1];
+            size_t last_process = min((b + 1) * header.block_size, n);
+            for (size_t i = b * header.block_size; i < last_process; i++) {
+                long long cpu_time = 0;
+                for (size_t k = burst_offset[i]; k < burst_offset[i + 1]; k++) {
+                    if (!getVarint(in, in_end, workload.bursts[k])) return false;
+                    if ((k - burst_offset[i]) % 2 == 0) cpu_time += workload.bursts[k];
+                }
+                workload.total_cpu_time[i] = cpu_time;
+            }
+            if (in != in_end) return false;
+        }
+        return true;
+    };
+
+    unsigned workers_count = 1;
+    if (header.payload_bytes >= PARALLEL_PARSE_MIN_BYTES) workers_count = max(1u, thread::hardware_concurrency());
+    workers_count = min<size_t>(workers_count, max<size_t>(blocks, 1));
+    vector<char> ok(workers_count);
+    vector<thread> workers;
+    for (unsigned w = 1; w < workers_count; w++) {
+        workers.emplace_back([&, w]() { ok[w] = decodeBlocks(blocks * w / workers_count, blocks * (w + 1) / workers_count); });
+    }
+    ok[0] = decodeBlocks(0, blocks / workers_count);
+    for (auto &worker : workers) worker.join();
+    if (find(ok.begin(), ok.end(), 0) != ok.end()) return false;
+
+    sortByArrival(workload);
+    return true;
+}
+
+// Function to parse the workload file. The file is memory mapped; binary workloads are loaded
+// column by column, and text workloads are parsed in place, split at newlines across several
+// threads when large. Returns false if the file cannot be opened.
+inline bool parseWorkloadFile(const string &file_path, Workload &workload) {
+    MappedFile file(file_path);
+    if (!file.data) {
+        // Empty files and files that cannot be mapped, such as pipes, are read as a stream
+        ifstream infile(file_path);
+        if (!infile) return false;
+        workload = parseWorkloadStream(infile);
+        return true;
+    }
+
+    if (isBinaryWorkload(file.data, file.size)) {
+        workload = Workload();
+        if (!loadBinaryWorkload(file.data, file.size, workload)) {
+            cerr << "Corrupt binary workload: " << file_path << "\n";
+            workload = Workload();
+        }
+        return true;
+    }
+
+    const char *end = file.data + file.size;
+    unsigned chunks = 1;
+    if (file.size >= PARALLEL_PARSE_MIN_BYTES) chunks = max(1u, thread::hardware_concurrency());
+
+    // Chunk boundaries sit just past a newline so no line is split between two threads
+    vector<const char *> bounds(1, file.data);
+    for (unsigned i = 1; i < chunks; i++) {
+        const char *p = max(file.data + file.size / chunks * i, bounds.back());
+        const char *newline = (const char *)memchr(p, '\n', end - p);
+        bounds.push_back(newline ? newline + 1 : end);
+    }
+    bounds.push_back(end);
+
+    vector<Workload> parts(chunks);
+    vector<thread> workers;
+    for (unsigned i = 1; i < chunks; i++) {
+        workers.emplace_back(parseWorkloadLines, bounds[i], bounds[i + 1], ref(parts[i]));
+    }
+    parseWorkloadLines(bounds[0], bounds[1], parts[0]);
+    for (auto &worker : workers) worker.join();
+
+    // Stitch the chunks together, renumbering ids to match their line order in the file
+    workload = move(parts[0]);
+    for (unsigned i = 1; i < chunks; i++) workload.append(parts[i], workload.size());
+
+    sortByArrival(workload);
+    return true;
+}
+
+// Arrival source that streams a text workload instead of loading it whole. A reader thread
+// reads the file (or stdin for "-") block by block, parses complete lines into chunks and hands
+// them over through a small bounded queue, so parsing overlaps with simulation. Admitted
+// processes are copied into recycled slots that are freed again when the process completes,
+// so memory follows the number of live processes rather than the size of the file. Processes
+// must appear in order of arrival; the reader stops at the first one that does not.
+class ProcessStream {
+public:
+    explicit ProcessStream(const string &file_path) {
+        input = file_path == "-" ? stdin : fopen(file_path.c_str(), "rb");
+        if (!input) return;
+        // Every chunk in flight can end up spare at once: the queued ones, the reader's and ours
+        spare_chunks.reserve(STREAM_QUEUE_CHUNKS + 2);
+        reader = thread(&ProcessStream::readChunks, this);
+    }
+
+    ~ProcessStream() {
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            stopping = true;
+        }
+        queue_changed.notify_all();
+        if (reader.joinable()) reader.join();
+        if (input && input != stdin) fclose(input);
+    }
+
+    ProcessStream(const ProcessStream &) = delete;
+    ProcessStream &operator=(const ProcessStream &) = delete;
+
+    bool opened() const { return input != nullptr; }
+
+    // Calls `handler` every `interval_ms` milliseconds while the simulator waits for input
+    void onIdle(int interval_ms, function<void()> handler) {
+        idle_interval = chrono::milliseconds(interval_ms);
+        idle_handler = move(handler);
+    }
+
+    // Reason the reader stopped early, empty if the whole input was read. Only meaningful
+    // once pending() has returned false.
+    const string &error() const { return read_error; }
+
+    // Time the reader spent parsing, also only meaningful once pending() has returned false
+    double parseSeconds() const { return parse_ns / 1e9; }
+
+    // Blocks until the next chunk is parsed when the current one is used up
+    bool pending() {
+        while (next_index == chunk.size()) {
+            if (!takeChunk()) return false;
+        }
+        return true;
+    }
+
+    long long nextArrivalTime() { return pending() ? chunk.arrival_time[next_index] : LLONG_MAX; }
+
+    Process *admit() {
+        int slot;
+        if (free_slots.empty()) {
+            slot = storage.size();
+            storage.emplace_back(chunk, next_index);
+            slot_bursts.emplace_back();
+        } else {
+            slot = free_slots.back();
+            free_slots.pop_back();
+            storage[slot] = Process(chunk, next_index);
+        }
+
+        // The chunk is dropped once it is used up, so the process gets its own copy of the bursts
+        Process &process = storage[slot];
+        slot_bursts[slot].assign(process.bursts, process.bursts + process.burst_count);
+        process.bursts = slot_bursts[slot].data();
+        process.slot = slot;
+        next_index++;
+        return &process;
+    }
+
+    void release(Process *process) { free_slots.push_back(process->slot); }
+
+private:
+    FILE *input = nullptr;
+    thread reader;
+
+    mutex queue_mutex;
+    condition_variable queue_changed;
+    deque<Workload> ready_chunks;   // Parsed chunks waiting for the simulator
+    vector<Workload> spare_chunks;  // Used-up chunks handed back to the reader to parse into
+    bool finished = false;          // The reader has queued its last chunk
+    bool stopping = false;          // The consumer is gone; the reader should quit
+    string read_error;
+    long long parse_ns = 0;
+    chrono::milliseconds idle_interval{0};
+    function<void()> idle_handler;
+
+    Workload chunk;                 // Chunk being admitted, owned by the simulator thread
+    size_t next_index = 0;
+    deque<Process> storage;         // Slots, with stable addresses
+    vector<vector<int>> slot_bursts;
+    vector<int> free_slots;
+
+    bool takeChunk() {
+        unique_lock<mutex> lock(queue_mutex);
+        auto available = [this] { return !ready_chunks.empty() || finished; };
+        if (idle_handler) {
+            while (!queue_changed.wait_for(lock, idle_interval, available)) {
+                lock.unlock();
+                idle_handler();
+                lock.lock();
+            }
+        } else {
+            queue_changed.wait(lock, available);
+        }
+        if (ready_chunks.empty()) return false;
+        // The used-up chunk goes back to the reader, so chunks are recycled rather than freed
+        spare_chunks.push_back(move(chunk));
+        chunk = move(ready_chunks.front());
+        ready_chunks.pop_front();
+        next_index = 0;
+        lock.unlock();
+        queue_changed.notify_all();
+        return true;
+    }
+
+    // Queues a parsed chunk, waiting while the queue is full. Returns false once the consumer
+    // has gone away.
+    bool putChunk(Workload &parsed) {
+        unique_lock<mutex> lock(queue_mutex);
+        queue_changed.wait(lock, [this] { return ready_chunks.size() < STREAM_QUEUE_CHUNKS || stopping; });
+        if (stopping) return false;
+        ready_chunks.push_back(move(parsed));
+        if (!spare_chunks.empty()) {
+            parsed = move(spare_chunks.back());
+            spare_chunks.pop_back();
+        }
+        lock.unlock();
+        queue_changed.notify_all();
+        return true;
+    }
+
+    void finish(const string &error) {
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            read_error = error;
+            finished = true;
+        }
+        queue_changed.notify_all();
+    }
+
+    void readChunks() {
+        vector<char> buffer;
+        Workload parsed;
+        size_t carried = 0;       // Bytes of an unfinished line kept from the previous block
+        int next_id = 0;
+        int last_arrival = INT_MIN;
+        bool at_end = false;
+
+        while (!at_end) {
+            buffer.resize(carried + STREAM_READ_BYTES);
+            // read() returns what a pipe holds so far, so live input is parsed as it comes in
+            ssize_t read_bytes = read(fileno(input), buffer.data() + carried, STREAM_READ_BYTES);
+            if (read_bytes < 0 && errno == EINTR) continue;
+            if (read_bytes < 0) {
+                finish("read error");
+                return;
+            }
+            if (next_id == 0 && isBinaryWorkload(buffer.data(), carried + read_bytes)) {
+                finish("streaming needs a text workload");
+                return;
+            }
+            at_end = read_bytes == 0;
+            size_t filled = carried + read_bytes;
+
+            // Parse up to the last complete line and carry the rest over to the next block
+            size_t parse_bytes = filled;
+            if (!at_end) {
+                const char *newline = (const char *)memrchr(buffer.data(), '\n', filled);
+                parse_bytes = newline ? newline - buffer.data() + 1 : 0;
+            }
+
+            auto parse_start = chrono::steady_clock::now();
+            parsed.clear();
+            parseWorkloadLines(buffer.data(), buffer.data() + parse_bytes, parsed);
+            parse_ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - parse_start).count();
+            for (size_t i = 0; i < parsed.size(); i++) {
+                if (parsed.arrival_time[i] < last_arrival) {
+                    finish("process " + to_string(next_id + i) + " arrives before the process ahead of it");
+                    return;
+                }
+                last_arrival = parsed.arrival_time[i];
+                parsed.id[i] += next_id;
+            }
+            next_id += parsed.size();
+            if (parsed.size() > 0 && !putChunk(parsed)) return;
+
+            carried = filled - parse_bytes;
+            memmove(buffer.data(), buffer.data() + parse_bytes, carried);
+        }
+        finish("");
+    }
+};
+
+#endif // WORKLOAD_H
@@ -0,0 +1,242 @@
+#include "Scheduler.h"
+#include "Workload.h"
+#include "Generator.h"
+#include "Simulator.h"
+#include <cstdio>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+// Slowdown of ns per decision against the baseline that counts as a regression
+const double BENCH_REGRESSION_RATIO = 1.25;
+
+// Growth of ns per decision over a tenfold size step that suggests a path went from O(log n)
+// to O(n); a logarithmic path grows by far less than this
+const double BENCH_SUPERLINEAR_RATIO = 4;
+
+// Measurements of one algorithm on one workload size
+struct BenchResult {
+    string algorithm;
+    long long processes = 0;
+    long long events = 0;
+    long long decisions = 0;
+    long long allocations = 0;   // Heap allocations made by the simulation loop
+    double parse_seconds = 0;
+    double sim_seconds = 0;
+    long peak_rss_kb = 0;
+
+    double eventsPerSecond() const { return sim_seconds > 0 ? events / sim_seconds : 0; }
+    double nsPerDecision() const { return decisions > 0 ? sim_seconds * 1e9 / decisions : 0; }
+};
+
+static string toJson(const BenchResult &result) {
+    char line[512];
+    snprintf(line, sizeof(line),
+             "{\"algorithm\": \"%s\", \"processes\": %lld, \"events\": %lld, \"decisions\": %lld, "
+             "\"allocations\": %lld, \"parse_seconds\": %.6f, \"sim_seconds\": %.6f, \"events_per_second\": %.0f, "
+             "\"ns_per_decision\": %.2f, \"peak_rss_kb\": %ld}",
+             result.algorithm.c_str(), result.processes, result.events, result.decisions, result.allocations, result.parse_seconds,
+             result.sim_seconds, result.eventsPerSecond(), result.nsPerDecision(), result.peak_rss_kb);
+    return line;
+}
+
+// Reads the number after "key": in one line of bench JSON, or -1 if it is missing
+static double jsonNumber(const string &line, const string &key) {
+    size_t at = line.find("\"" + key + "\": ");
+    if (at == string::npos) return -1;
+    return atof(line.c_str() + at + key.size() + 4);
+}
+
+static string jsonString(const string &line, const string &key) {
+    size_t at = line.find("\"" + key + "\": \"");
+    if (at == string::npos) return "";
+    size_t begin = at + key.size() + 5;
+    return line.substr(begin, line.find('"', begin) - begin);
+}
+
+// Writes the generated benchmark workload of `processes` processes as text
+static bool writeBenchWorkload(long long processes, const string &path) {
+    GeneratorConfig generator;
+    generator.processes = processes;
+    generator.arrival_rate = 0.03;
+    generator.cpu_bursts = 2;
+    generator.nice_spread = 10;
+
+    Workload generated;
+    if (!generateWorkload(generator, generated, thread::hardware_concurrency())) return false;
+    string text;
+    formatWorkloadText(generated, text);
+    FILE *out = fopen(path.c_str(), "wb");
+    if (!out) return false;
+    bool ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+    return fclose(out) == 0 && ok;
+}
+
+// Times parsing the workload at `path` and simulating `algorithm` on one core
+static BenchResult benchOne(const string &algorithm, long long processes, const string &path) {
+    BenchResult result;
+    result.algorithm = algorithm;
+    result.processes = processes;
+
+    auto parse_start = chrono::steady_clock::now();
+    // The benchmark wrote the workload itself just before
+    Workload workload;
+    parseWorkloadFile(path, workload);
+    result.parse_seconds = chrono::duration<double>(chrono::steady_clock::now() - parse_start).count();
+
+    vector<Process> processes_state = makeProcesses(workload);
+    ProcessArray<Process> arrivals(processes_state);
+    SimConfig config;
+    SimCounters counters;
+
+    auto sim_start = chrono::steady_clock::now();
+    visitPolicy(algorithm, [&](auto policy) {
+        Simulator<typename decltype(policy)::type, UniCore> simulator(config, UniCore());
+        simulator.run(arrivals);
+        counters = simulator.counters;
+    });
+    result.sim_seconds = chrono::duration<double>(chrono::steady_clock::now() - sim_start).count();
+    result.events = counters.events;
+    result.decisions = counters.decisions;
+    result.allocations = counters.allocations;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    result.peak_rss_kb = usage.ru_maxrss;
+    return result;
+}
+
+// Runs `task` in a forked child, so peak RSS and memory growth stay confined to it, and reads
+// back the line it returns. An empty line counts as failure.
+template <typename Task>
+static bool runInChild(Task task, string &output) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    pid_t child = fork();
+    if (child < 0) return false;
+    if (child == 0) {
+        close(fds[0]);
+        string line = task();
+        ssize_t written = write(fds[1], line.data(), line.size());
+        _exit(!line.empty() && written == (ssize_t)line.size() ? 0 : 1);
+    }
+
+    close(fds[1]);
+    output.clear();
+    char buffer[512];
+    ssize_t bytes;
+    while ((bytes = read(fds[0], buffer, sizeof(buffer))) > 0) output.append(buffer, bytes);
+    close(fds[0]);
+    int status;
+    waitpid(child, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Runs every algorithm over generated workloads from 1e3 up to --max-size processes and prints
+// the measurements as JSON, one result per line. With --baseline the results are compared to
+// an earlier run and the exit status is 1 if a case got slower per decision or scales
+// superlinearly.
+int main(int argc, char *argv[]) {
+    long long max_size = 10000000;
+    string baseline_path, output_path;
+    vector<string> algorithms = {"FIFO", "SJF", "SJF-Preemptive", "CFS", "RR", "MLFQ", "EEVDF", "EDF"};
+
+    for (int i = 1; i < argc; i += 2) {
+        string option = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Missing value for option: " << option << "\n";
+            return 1;
+        }
+        string value = argv[i + 1];
+        if (option == "--max-size") {
+            max_size = atoll(value.c_str());
+        } else if (option == "--baseline") {
+            baseline_path = value;
+        } else if (option == "--output") {
+            output_path = value;
+        } else {
+            cerr << "Unknown option: " << option << "\n";
+            return 1;
+        }
+    }
+
+    // Each size is generated once and measured for every algorithm in a fresh child process
+    string scratch_path = "/tmp/bench_workload_" + to_string(getpid()) + ".dat";
+    vector<long long> sizes;
+    for (long long size = 1000; size <= max_size; size *= 10) sizes.push_back(size);
+    vector<vector<string>> results(algorithms.size(), vector<string>(sizes.size()));
+    for (size_t s = 0; s < sizes.size(); s++) {
+        string status;
+        bool written = runInChild([&]() { return writeBenchWorkload(sizes[s], scratch_path) ? string("ok") : string(); }, status);
+        if (!written) {
+            cerr << "Could not generate a workload of " << sizes[s] << " processes\n";
+            remove(scratch_path.c_str());
+            return 1;
+        }
+        for (size_t a = 0; a < algorithms.size(); a++) {
+            string &json = results[a][s];
+            if (!runInChild([&]() { return toJson(benchOne(algorithms[a], sizes[s], scratch_path)); }, json)) {
+                cerr << "Benchmark failed: " << algorithms[a] << " with " << sizes[s] << " processes\n";
+                remove(scratch_path.c_str());
+                return 1;
+            }
+            cerr << algorithms[a] << " " << sizes[s] << ": " << jsonNumber(json, "ns_per_decision") << " ns per decision\n";
+        }
+    }
+    remove(scratch_path.c_str());
+
+    vector<string> lines;
+    for (const auto &per_size : results) lines.insert(lines.end(), per_size.begin(), per_size.end());
+
+    string report = "{\"results\": [\n";
+    for (size_t i = 0; i < lines.size(); i++) report += "  " + lines[i] + (i + 1 < lines.size() ? ",\n" : "\n");
+    report += "]}\n";
+    cout << report;
+    if (!output_path.empty()) {
+        ofstream out(output_path);
+        out << report;
+    }
+
+    bool regressed = false;
+
+    // Scaling within this run: ns per decision should stay nearly flat as the size grows
+    for (size_t i = 1; i < lines.size(); i++) {
+        if (jsonString(lines[i], "algorithm") != jsonString(lines[i - 1], "algorithm")) continue;
+        double before = jsonNumber(lines[i - 1], "ns_per_decision");
+        double after = jsonNumber(lines[i], "ns_per_decision");
+        if (before > 0 && after > before * BENCH_SUPERLINEAR_RATIO) {
+            cerr << "SUPERLINEAR: " << jsonString(lines[i], "algorithm") << " at "
+                 << (long long)jsonNumber(lines[i], "processes") << " processes: " << before << " -> "
+                 << after << " ns per decision\n";
+            regressed = true;
+        }
+    }
+
+    // Against the baseline: the same algorithm and size should not be slower per decision
+    if (!baseline_path.empty()) {
+        ifstream baseline(baseline_path);
+        if (!baseline) {
+            cerr << "Could not open baseline: " << baseline_path << "\n";
+            return 1;
+        }
+        string old_line;
+        while (getline(baseline, old_line)) {
+            string algorithm = jsonString(old_line, "algorithm");
+            if (algorithm.empty()) continue;
+            double processes = jsonNumber(old_line, "processes");
+            for (const string &line : lines) {
+                if (jsonString(line, "algorithm") != algorithm || jsonNumber(line, "processes") != processes) continue;
+                double before = jsonNumber(old_line, "ns_per_decision");
+                double after = jsonNumber(line, "ns_per_decision");
+                if (before > 0 && after > before * BENCH_REGRESSION_RATIO) {
+                    cerr << "REGRESSION: " << algorithm << " at " << (long long)processes << " processes: "
+                         << before << " -> " << after << " ns per decision\n";
+                    regressed = true;
+                }
+            }
+        }
+    }
+
+    return regressed ? 1 : 0;
+}
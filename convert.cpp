@@ -0,0 +1,25 @@
+#include "Scheduler.h"
+#include "Workload.h"
+
+using namespace std;
+
+// Converts a text workload into the binary workload format so later runs can load it without parsing
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        cerr << "Usage: " << argv[0] << " <path-to-text-workload> <path-to-binary-workload>\n";
+        return 1;
+    }
+
+    Workload workload;
+    if (!parseWorkloadFile(argv[1], workload)) {
+        cerr << "Could not open workload file: " << argv[1] << "\n";
+        return 1;
+    }
+    if (!writeBinaryWorkload(workload, argv[2])) {
+        cerr << "Could not write binary workload: " << argv[2] << "\n";
+        return 1;
+    }
+
+    cout << "Converted " << workload.size() << " processes with " << workload.bursts.size() << " bursts" << endl;
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "Scheduler.h"
+#include "Workload.h"
+#include "Generator.h"
+#include <cstdio>
+
+using namespace std;
+
+// Generates a synthetic workload and writes it as text, to a file or to stdout so it can be
+// piped into a streaming simulator run, or in the binary workload format
+int main(int argc, char *argv[]) {
+    GeneratorConfig config;
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    string output_path = "-";
+    bool binary = false;
+
+    // Settings are "--name value" pairs; the optional last argument is the output file
+    for (int i = 1; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--binary") {
+            binary = true;
+            continue;
+        }
+        if (option.compare(0, 2, "--") != 0) {
+            output_path = option;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Missing value for option: " << option << "\n";
+            return 1;
+        }
+        string text = argv[++i];
+        double value = atof(text.c_str());
+        if (option == "--processes") {
+            config.processes = atoll(text.c_str());
+        } else if (option == "--seed") {
+            config.seed = strtoull(text.c_str(), nullptr, 10);
+        } else if (option == "--arrivals") {
+            if (text == "poisson") {
+                config.arrivals = ArrivalPattern::Poisson;
+            } else if (text == "bursty") {
+                config.arrivals = ArrivalPattern::Bursty;
+            } else {
+                cerr << "Unknown arrival pattern: " << text << "\n";
+                return 1;
+            }
+        } else if (option == "--rate") {
+            config.arrival_rate = value;
+        } else if (option == "--cluster-size") {
+            config.cluster_size = value;
+        } else if (option == "--cpu") {
+            if (text == "pareto") {
+                config.cpu = BurstDistribution::Pareto;
+            } else if (text == "lognormal") {
+                config.cpu = BurstDistribution::Lognormal;
+            } else {
+                cerr << "Unknown burst distribution: " << text << "\n";
+                return 1;
+            }
+        } else if (option == "--cpu-min") {
+            config.cpu_min = value;
+        } else if (option == "--pareto-alpha") {
+            config.pareto_alpha = value;
+        } else if (option == "--lognormal-mu") {
+            config.lognormal_mu = value;
+        } else if (option == "--lognormal-sigma") {
+            config.lognormal_sigma = value;
+        } else if (option == "--cpu-max") {
+            config.cpu_max = atoi(text.c_str());
+        } else if (option == "--cpu-bursts") {
+            config.cpu_bursts = value;
+        } else if (option == "--io-mean") {
+            config.io_mean = value;
+        } else if (option == "--nice-spread") {
+            config.nice_spread = atoi(text.c_str());
+        } else if (option == "--deadline-slack") {
+            config.deadline_slack = value;
+        } else if (option == "--threads") {
+            threads = max(1, atoi(text.c_str()));
+        } else {
+            cerr << "Unknown option: " << option << "\n";
+            return 1;
+        }
+    }
+
+    if (config.processes < 0 || config.processes > INT_MAX || config.arrival_rate <= 0 ||
+        config.pareto_alpha <= 0 || config.cpu_max < 1) {
+        cerr << "Invalid generator settings\n";
+        return 1;
+    }
+
+    if (binary) {
+        if (output_path == "-") {
+            cerr << "The binary format needs an output file\n";
+            return 1;
+        }
+        Workload workload;
+        if (!generateWorkload(config, workload, threads)) {
+            cerr << "Arrival times overflow; lower --processes or raise --rate\n";
+            return 1;
+        }
+        if (!writeBinaryWorkload(workload, output_path)) {
+            cerr << "Could not write binary workload: " << output_path << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    FILE *out = output_path == "-" ? stdout : fopen(output_path.c_str(), "wb");
+    if (!out) {
+        cerr << "Could not open output file: " << output_path << "\n";
+        return 1;
+    }
+
+    // Text is produced a batch of blocks at a time, so memory stays flat at any size
+    size_t blocks = generatorBlockCount(config);
+    size_t batch = 2 * threads;
+    double start = 0;
+    vector<GeneratedBlock> generated;
+    vector<string> text(batch);
+    for (size_t begin = 0; begin < blocks; begin += batch) {
+        size_t end = min(blocks, begin + batch);
+        if (!generateBlocks(config, begin, end, threads, generated, start)) {
+            cerr << "Arrival times overflow; lower --processes or raise --rate\n";
+            return 1;
+        }
+
+        vector<thread> workers;
+        for (size_t b = 1; b < generated.size(); b++) {
+            workers.emplace_back([&, b]() {
+                text[b].clear();
+                formatWorkloadText(generated[b].workload, text[b]);
+            });
+        }
+        text[0].clear();
+        formatWorkloadText(generated[0].workload, text[0]);
+        for (auto &worker : workers) worker.join();
+
+        for (size_t b = 0; b < generated.size(); b++) fwrite(text[b].data(), 1, text[b].size(), out);
+    }
+
+    bool ok = fflush(out) == 0 && !ferror(out);
+    if (out != stdout) ok = fclose(out) == 0 && ok;
+    if (!ok) {
+        cerr << "Could not write output file: " << output_path << "\n";
+        return 1;
+    }
+    return 0;
+}
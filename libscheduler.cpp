@@ -0,0 +1,50 @@
+#include "SchedulerLibrary.h"
+#include "Simulator.h"
+#include "FIFOScan.h"
+
+using namespace std;
+
+template <typename Sim>
+static void collectResult(const Sim &simulator, RunResult &result) {
+    result.metrics = simulator.totalMetrics();
+    for (int i = 0; i < simulator.coreCount(); i++) result.makespan = max(result.makespan, simulator.lastCompletion(i));
+    SimCounters counters = simulator.totalCounters();
+    result.events = counters.events;
+    result.decisions = counters.decisions;
+}
+
+bool RunContext::run(const WorkloadView &workload, const string &algorithm, const SimConfig &config, const SMPConfig &smp,
+                     RunResult &result) {
+    if (smp.cores < 1) return false;
+    result = RunResult();
+
+    // Single-burst FIFO on one core is a prefix scan over the arrays themselves. It stays on
+    // the calling thread, since the caller decides how its runs are spread over threads. The
+    // view may start partway into its burst array, so the bursts begin at the first offset.
+    size_t n = workload.size();
+    const int *bursts = workload.bursts + (n > 0 ? workload.burst_offset[0] : 0);
+    if (algorithm == "FIFO" && smp.cores == 1 && !config.trace && singleBursts(workload.burst_offset, n) &&
+        scanFits(workload.arrival_time, bursts, n, config.switching.context_switch)) {
+        FIFOScanResult scan = scanFIFO(workload.arrival_time, bursts, workload.deadline, n,
+                                       config.switching.context_switch, 1);
+        result.metrics = scan.metrics;
+        result.makespan = scan.last_completion;
+        result.decisions = scan.counters.decisions;
+        return true;
+    }
+
+    makeProcesses(workload, processes);
+    ProcessArray<Process> arrivals(processes);
+    return visitPolicy(algorithm, [&](auto policy) {
+        using Policy = typename decltype(policy)::type;
+        if (smp.cores == 1) {
+            Simulator<Policy, UniCore> simulator(config, UniCore());
+            simulator.run(arrivals);
+            collectResult(simulator, result);
+        } else {
+            Simulator<Policy, MultiCore> simulator(config, MultiCore{smp});
+            simulator.run(arrivals);
+            collectResult(simulator, result);
+        }
+    });
+}
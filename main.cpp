@@ -1,274 +1,223 @@
 #include "Scheduler.h"
+#include "Workload.h"
+#include "Simulator.h"
+#include "FIFOScan.h"
+#include "ResultCache.h"
 #include <sstream>
-#include <chrono>
-
-// Definition of the Process constructor
-Process::Process(int id, int arrival_time, vector<int> cpu_bursts, vector<int> io_bursts)
-    : id(id), arrival_time(arrival_time), cpu_bursts(cpu_bursts), io_bursts(io_bursts),
-      current_burst(0), remaining_time(cpu_bursts.empty() ? 0 : cpu_bursts[0]),
-      turnaround_time(0), waiting_time(0), completion_time(0) {}
-
-// Implementations of functions
-vector<Process> parseWorkloadFile(const string &file_path) {
-    ifstream infile(file_path);
-    vector<Process> processes;  
-    int arrival_time, burst;
-    int process_id = 0;
-    string line;
-
-    // Outer loop: Reads each line for a new process
-    while (getline(infile, line)) {
-        istringstream iss(line);
-        iss >> arrival_time;  // Read arrival time for a new process
-
-        vector<int> cpu_bursts;
-        vector<int> io_bursts;
-
-        // Inner loop: Reads bursts until -1 is found
-        while (iss >> burst && burst != -1) {
-            cpu_bursts.push_back(burst);  // Add CPU burst
-
-            if (iss >> burst && burst != -1) {  // Read IO burst if available
-                io_bursts.push_back(burst);
-            }
-        }
-
-        // Add the parsed process to the list
-        processes.emplace_back(process_id++, arrival_time, cpu_bursts, io_bursts);
-    }
-
-    return processes;
-}
-
 #include <chrono>
 #include <iostream>
 #include <vector>
+#include <memory>
 
 using namespace std;
 using namespace std::chrono;
 
-void runFIFO(vector<Process> &processes) {
-    int current_time = 0;
-    int total_turnaround_time = 0, total_waiting_time = 0;
-    int max_turnaround_time = 0, max_waiting_time = 0;
-
-    auto start_time = high_resolution_clock::now();
-
-    for (auto &process : processes) {
-        if (current_time < process.arrival_time) {
-            current_time = process.arrival_time;
-        }
-        process.waiting_time = current_time - process.arrival_time;
-        for (int burst : process.cpu_bursts) {
-            current_time += burst;
-        }
-        process.turnaround_time = current_time - process.arrival_time;
-        process.completion_time = current_time;
-
-        total_turnaround_time += process.turnaround_time;
-        total_waiting_time += process.waiting_time;
-
-        if (process.turnaround_time > max_turnaround_time) max_turnaround_time = process.turnaround_time;
-        if (process.waiting_time > max_waiting_time) max_waiting_time = process.waiting_time;
-    }
-
-    auto end_time = high_resolution_clock::now();
-    duration<double> elapsed_time = end_time - start_time;
-
-    int n = processes.size();
-    cout << "FIFO Average Turnaround Time: " << (double)total_turnaround_time / n << endl;
-    cout << "FIFO Max Turnaround Time: " << max_turnaround_time << endl;
-    cout << "FIFO Average Waiting Time: " << (double)total_waiting_time / n << endl;
-    cout << "FIFO Max Waiting Time: " << max_waiting_time << endl;
-    cout << "FIFO Throughput: " << (double)n / elapsed_time.count() << " processes per second" << endl;
-    cout << "FIFO Simulator Run Time: " << elapsed_time.count() << " seconds" << endl;
+// Runs the named algorithm on one core over an arrival source and prints its metrics, and
+// with `stats` ("text" or "json") its counters. The result goes to `run` for the result cache.
+// Returns false for an unknown algorithm.
+template <typename Arrivals>
+bool runAlgorithm(const string &algorithm, Arrivals &arrivals, const SimConfig &config, const string &stats,
+                  double parse_seconds, CachedRun &run) {
+    return visitPolicy(algorithm, [&](auto policy) {
+        using Policy = typename decltype(policy)::type;
+        auto start_time = steady_clock::now();
+        Simulator<Policy, UniCore> simulator(config, UniCore());
+        simulator.run(arrivals);
+        if (config.windows) config.windows->finish(simulator.lastCompletion(0));
+        duration<double> elapsed_time = steady_clock::now() - start_time;
+        printRunMetrics(Policy::NAME, simulator.metrics(0), elapsed_time.count());
+        run.metrics = {simulator.metrics(0)};
+        run.last_completion = {simulator.lastCompletion(0)};
+        run.seconds = elapsed_time.count();
+        if (stats.empty()) return;
+        // A stream is parsed by its reader thread while the simulation runs
+        if constexpr (is_same<Arrivals, ProcessStream>::value) parse_seconds = arrivals.parseSeconds();
+        printStats(Policy::NAME, simulator.totalCounters(), {}, parse_seconds, stats == "json");
+    });
 }
 
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <scheduling-algorithm> <path-to-workload-description-file>"
+             << " [--stream] [--window N] [--window-ms N] [--stats text|json] [--cache DIR] [--cache-size MB] [--trace FILE] [--trace-events N] [--io-devices N] [--sched-latency N] [--min-granularity N] [--wakeup-granularity N]"
+             << " [--quantum N] [--mlfq-levels N] [--mlfq-quantum N] [--mlfq-boost N] [--eevdf-slice N]"
+             << " [--context-switch N] [--migration-cost N] [--cache-refill N] [--cache-half-life N]\n";
+        return 1;
+    }
 
-void runNonPreemptiveSJF(vector<Process> &processes) {
-    int current_time = 0;
-    int total_turnaround_time = 0, total_waiting_time = 0;
-    int max_turnaround_time = 0, max_waiting_time = 0;
-    vector<Process*> ready_queue;
-
-    auto start_time = chrono::steady_clock::now();
-
-    while (!processes.empty() || !ready_queue.empty()) {
-        for (auto it = processes.begin(); it != processes.end();) {
-            if (it->arrival_time <= current_time) {
-                ready_queue.push_back(&(*it));
-                it = processes.erase(it);
-            } else {
-                ++it;
-            }
-        }
+    string algorithm = argv[1];
+    string file_path = argv[2];
 
-        if (ready_queue.empty()) {
-            current_time++;
+    // Optional settings follow the workload file as "--name value" pairs or bare flags
+    SimConfig config;
+    bool stream = false;
+    int window = 0, window_ms = 0;
+    string stats;
+    string cache_path;
+    long long cache_bytes = DEFAULT_CACHE_BYTES;
+    string trace_path;
+    int trace_events = DEFAULT_TRACE_EVENTS;
+    for (int i = 3; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--stream") {
+            stream = true;
             continue;
         }
-
-        auto shortest_process = min_element(ready_queue.begin(), ready_queue.end(),
-                                            [](Process *a, Process *b) { return a->remaining_time < b->remaining_time; });
-
-        Process *process = *shortest_process;
-        ready_queue.erase(shortest_process);
-
-        process->waiting_time = current_time - process->arrival_time;
-        current_time += process->remaining_time;
-        process->turnaround_time = current_time - process->arrival_time;
-        process->completion_time = current_time;
-
-        total_turnaround_time += process->turnaround_time;
-        total_waiting_time += process->waiting_time;
-
-        if (process->turnaround_time > max_turnaround_time) max_turnaround_time = process->turnaround_time;
-        if (process->waiting_time > max_waiting_time) max_waiting_time = process->waiting_time;
+        if (i + 1 >= argc) {
+            cerr << "Missing value for option: " << option << "\n";
+            return 1;
+        }
+        string text = argv[++i];
+        int value = atoi(text.c_str());
+        if (option == "--trace") {
+            trace_path = text;
+        } else if (option == "--stats") {
+            stats = text;
+        } else if (option == "--cache") {
+            cache_path = text;
+        } else if (option == "--cache-size") {
+            cache_bytes = atoll(text.c_str()) << 20;
+        } else if (option == "--window") {
+            window = value;
+        } else if (option == "--window-ms") {
+            window_ms = value;
+        } else if (option == "--trace-events") {
+            trace_events = value;
+        } else if (option == "--io-devices") {
+            config.io_devices = value;
+        } else if (option == "--sched-latency") {
+            config.cfs.sched_latency = value;
+        } else if (option == "--min-granularity") {
+            config.cfs.min_granularity = value;
+        } else if (option == "--wakeup-granularity") {
+            config.cfs.wakeup_granularity = value;
+        } else if (option == "--quantum") {
+            config.rr_quantum = value;
+        } else if (option == "--mlfq-levels") {
+            config.mlfq.levels = value;
+        } else if (option == "--mlfq-quantum") {
+            config.mlfq.quantum = value;
+        } else if (option == "--mlfq-boost") {
+            config.mlfq.boost_interval = value;
+        } else if (option == "--eevdf-slice") {
+            config.eevdf_slice = value;
+        } else if (option == "--context-switch") {
+            config.switching.context_switch = value;
+        } else if (option == "--migration-cost") {
+            config.switching.migration = value;
+        } else if (option == "--cache-refill") {
+            config.switching.cache_refill = value;
+        } else if (option == "--cache-half-life") {
+            config.switching.cache_half_life = value;
+        } else {
+            cerr << "Unknown option: " << option << "\n";
+            return 1;
+        }
     }
 
-    auto end_time = chrono::steady_clock::now();
-    chrono::duration<double> elapsed_time = end_time - start_time;
-
-    int n = processes.size();
-    cout << "Non-Preemptive SJF Average Turnaround Time: " << (double)total_turnaround_time / n << endl;
-    cout << "Non-Preemptive SJF Max Turnaround Time: " << max_turnaround_time << endl;
-    cout << "Non-Preemptive SJF Average Waiting Time: " << (double)total_waiting_time / n << endl;
-    cout << "Non-Preemptive SJF Max Waiting Time: " << max_waiting_time << endl;
-    cout << "Non-Preemptive SJF Throughput: " << (double)n / elapsed_time.count() << " processes per second" << endl;
-    cout << "Non-Preemptive SJF Simulator Run Time: " << elapsed_time.count() << " seconds" << endl;
-}
+    if (!stats.empty() && stats != "text" && stats != "json") {
+        cerr << "Unknown stats format: " << stats << "\n";
+        return 1;
+    }
+    if (window < 0 || window_ms < 0 || (window > 0 && window_ms > 0)) {
+        cerr << "Give either --window or --window-ms, as a positive number\n";
+        return 1;
+    }
 
-void runPreemptiveSJF(vector<Process> &processes) {
-    int current_time = 0;
-    int total_turnaround_time = 0, total_waiting_time = 0;
-    int max_turnaround_time = 0, max_waiting_time = 0;
-    vector<Process*> ready_queue;
+    // Results are only cached for whole runs over a workload file, reported as a whole
+    bool live = stream || window > 0 || window_ms > 0;
+    if (!cache_path.empty() && (live || !trace_path.empty() || !stats.empty())) {
+        cerr << "--cache cannot be combined with --stream, --window, --window-ms, --trace or --stats\n";
+        return 1;
+    }
 
-    auto start_time = chrono::steady_clock::now();
+    // The trace rings are allocated before the run so recording never allocates
+    unique_ptr<Tracer> tracer;
+    if (!trace_path.empty()) {
+        tracer.reset(new Tracer(1, max(trace_events, 1)));
+        config.trace = tracer.get();
+    }
 
-    while (!processes.empty() || !ready_queue.empty()) {
-        for (auto it = processes.begin(); it != processes.end();) {
-            if (it->arrival_time <= current_time) {
-                ready_queue.push_back(&(*it));
-                it = processes.erase(it);
-            } else {
-                ++it;
-            }
+    CachedRun run;
+    if (live) {
+        // Arrival-sorted text workloads (or "-" for stdin) are simulated while they are read.
+        // With windows the run is live: metrics are reported as it goes, also while the input
+        // is idle, so a pipe from a running collector can feed it indefinitely.
+        ProcessStream arrivals(file_path);
+        if (!arrivals.opened()) {
+            cerr << "Could not open workload file: " << file_path << "\n";
+            return 1;
         }
-
-        if (ready_queue.empty()) {
-            current_time++;
-            continue;
+        unique_ptr<WindowedMetrics> windows;
+        if (window > 0 || window_ms > 0) {
+            windows.reset(new WindowedMetrics(window, window_ms, stdout));
+            config.windows = windows.get();
+            arrivals.onIdle(windows->idleTimeoutMs(), [&]() { windows->idle(); });
         }
-
-        auto shortest_process = min_element(ready_queue.begin(), ready_queue.end(),
-                                            [](Process *a, Process *b) { return a->remaining_time < b->remaining_time; });
-
-        Process *process = *shortest_process;
-        process->remaining_time--;
-        current_time++;
-
-        if (process->remaining_time == 0) {
-            ready_queue.erase(shortest_process);
-            process->turnaround_time = current_time - process->arrival_time;
-            process->completion_time = current_time;
-            total_turnaround_time += process->turnaround_time;
-            total_waiting_time += (process->turnaround_time - accumulate(process->cpu_bursts.begin(), process->cpu_bursts.end(), 0));
-            
-            if (process->turnaround_time > max_turnaround_time) max_turnaround_time = process->turnaround_time;
-            if ((process->turnaround_time - accumulate(process->cpu_bursts.begin(), process->cpu_bursts.end(), 0)) > max_waiting_time) 
-                max_waiting_time = (process->turnaround_time - accumulate(process->cpu_bursts.begin(), process->cpu_bursts.end(), 0));
+        if (!runAlgorithm(algorithm, arrivals, config, stats, 0, run)) {
+            cerr << "Unknown scheduling algorithm: " << algorithm << "\n";
+            return 1;
         }
-    }
-
-    auto end_time = chrono::steady_clock::now();
-    chrono::duration<double> elapsed_time = end_time - start_time;
-
-    int n = processes.size();
-    cout << "Preemptive SJF Average Turnaround Time: " << (double)total_turnaround_time / n << endl;
-    cout << "Preemptive SJF Max Turnaround Time: " << max_turnaround_time << endl;
-    cout << "Preemptive SJF Average Waiting Time: " << (double)total_waiting_time / n << endl;
-    cout << "Preemptive SJF Max Waiting Time: " << max_waiting_time << endl;
-    cout << "Preemptive SJF Throughput: " << (double)n / elapsed_time.count() << " processes per second" << endl;
-    cout << "Preemptive SJF Simulator Run Time: " << elapsed_time.count() << " seconds" << endl;
-}
-
-void runCFS(vector<Process> &processes) {
-    int current_time = 0;
-    int total_turnaround_time = 0, total_waiting_time = 0;
-    int max_turnaround_time = 0, max_waiting_time = 0;
-    map<int, Process*> cfs_tree;
-
-    auto start_time = chrono::steady_clock::now();
-
-    while (!processes.empty() || !cfs_tree.empty()) {
-        for (auto it = processes.begin(); it != processes.end();) {
-            if (it->arrival_time <= current_time) {
-                cfs_tree[it->remaining_time] = &(*it);
-                it = processes.erase(it);
-            } else {
-                ++it;
-            }
+        if (!arrivals.error().empty()) {
+            cerr << "Streaming stopped early: " << arrivals.error() << "\n";
+            return 1;
         }
+        return writeTrace(tracer.get(), trace_path);
+    }
 
-        if (cfs_tree.empty()) {
-            current_time++;
-            continue;
+    // A cached result of the same workload contents and settings is reported as it was first
+    // reported, without parsing the workload. Workloads that cannot be mapped are not cached.
+    unique_ptr<ResultCache> cache;
+    string description;
+    ContentHash workload_hash;
+    if (!cache_path.empty() && hashWorkloadFile(file_path, workload_hash)) {
+        cache.reset(new ResultCache(cache_path, cache_bytes));
+        if (!cache->opened()) {
+            cerr << "Could not open cache directory: " << cache_path << "\n";
+            return 1;
         }
-
-        auto first_process = cfs_tree.begin();
-        Process *process = first_process->second;
-        process->remaining_time--;
-        current_time++;
-
-        if (process->remaining_time == 0) {
-            cfs_tree.erase(first_process);
-            process->turnaround_time = current_time - process->arrival_time;
-            process->completion_time = current_time;
-            total_turnaround_time += process->turnaround_time;
-            total_waiting_time += (process->turnaround_time - accumulate(process->cpu_bursts.begin(), process->cpu_bursts.end(), 0));
-            
-            if (process->turnaround_time > max_turnaround_time) max_turnaround_time = process->turnaround_time;
-            if ((process->turnaround_time - accumulate(process->cpu_bursts.begin(), process->cpu_bursts.end(), 0)) > max_waiting_time) 
-                max_waiting_time = (process->turnaround_time - accumulate(process->cpu_bursts.begin(), process->cpu_bursts.end(), 0));
+        SMPConfig smp;
+        smp.cores = 1;
+        description = describeRun(workload_hash, "UniCore", algorithm, config, smp);
+        if (cache->lookup(description, run)) {
+            visitPolicy(algorithm, [&](auto policy) {
+                printRunMetrics(decltype(policy)::type::NAME, run.metrics[0], run.seconds);
+            });
+            return 0;
         }
     }
 
-    auto end_time = chrono::steady_clock::now();
-    chrono::duration<double> elapsed_time = end_time - start_time;
-
-    int n = processes.size();
-    cout << "CFS Average Turnaround Time: " << (double)total_turnaround_time / n << endl;
-    cout << "CFS Max Turnaround Time: " << max_turnaround_time << endl;
-    cout << "CFS Average Waiting Time: " << (double)total_waiting_time / n << endl;
-    cout << "CFS Max Waiting Time: " << max_waiting_time << endl;
-    cout << "CFS Throughput: " << (double)n / elapsed_time.count() << " processes per second" << endl;
-    cout << "CFS Simulator Run Time: " << elapsed_time.count() << " seconds" << endl;
-}
-
-int main(int argc, char *argv[]) {
-    if (argc < 3) {
-        cerr << "Usage: " << argv[0] << " <scheduling-algorithm> <path-to-workload-description-file>\n";
+    auto parse_start = steady_clock::now();
+    Workload workload;
+    if (!parseWorkloadFile(file_path, workload)) {
+        cerr << "Could not open workload file: " << file_path << "\n";
         return 1;
     }
+    duration<double> parse_time = steady_clock::now() - parse_start;
+
+    // FIFO over single-burst processes is a prefix scan of the workload, with no simulation
+    if (algorithm == "FIFO" && fifoScanApplies(workload, config)) {
+        auto start_time = steady_clock::now();
+        FIFOScanResult result = scanFIFO(workload, config);
+        duration<double> elapsed_time = steady_clock::now() - start_time;
+        printRunMetrics(FIFOPolicy::NAME, result.metrics, elapsed_time.count());
+        if (!stats.empty()) printStats(FIFOPolicy::NAME, result.counters, {}, parse_time.count(), stats == "json");
+        run.metrics = {result.metrics};
+        run.last_completion = {result.last_completion};
+        run.seconds = elapsed_time.count();
+        if (cache && !cache->store(description, run)) cerr << "Could not write to cache directory: " << cache_path << "\n";
+        return 0;
+    }
 
-    string algorithm = argv[1];
-    string file_path = argv[2];
-
-    vector<Process> processes = parseWorkloadFile(file_path);
+    vector<Process> processes = makeProcesses(workload);
+    parse_time = steady_clock::now() - parse_start;
+    ProcessArray<Process> arrivals(processes);
 
-    if (algorithm == "FIFO") {
-        runFIFO(processes);
-    } else if (algorithm == "SJF") {
-        runNonPreemptiveSJF(processes);
-    } else if (algorithm == "SJF-Preemptive") {
-        runPreemptiveSJF(processes);
-    } else if (algorithm == "CFS") {
-        runCFS(processes);
-    } else {
+    if (!runAlgorithm(algorithm, arrivals, config, stats, parse_time.count(), run)) {
         cerr << "Unknown scheduling algorithm: " << algorithm << "\n";
         return 1;
     }
+    if (cache && !cache->store(description, run)) cerr << "Could not write to cache directory: " << cache_path << "\n";
 
-    return 0;
+    return writeTrace(tracer.get(), trace_path);
 }
@@ -1,4 +1,7 @@
 #include "Scheduler.h"
+#include "Workload.h"
+#include "Simulator.h"
+#include "FIFOScan.h"
 #include <sstream>
 #include <chrono>
 #include <queue>
@@ -8,277 +11,296 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <atomic>
+#include <thread>
+#include <memory>
 
 using namespace std::chrono;
 using namespace std;
 
 // Definition of the Processor struct
 struct Processor {
-    int id;                     // Processor ID (0 or 1)
-    int current_time;           // Current time on the processor
+    int id;                     // Processor ID
+    long long current_time;     // Current time on the processor
     queue<Process*> ready_queue; // Queue of processes ready to run on this processor
 };
 
-// Function to run the FIFO scheduling algorithm with separate metrics for each processor
-void runFIFO(vector<Processor> &processors) {
-    auto start_time = high_resolution_clock::now();
-
-    int processor_index = 0;  // To keep track of which processor we're working on
-    for (auto &processor : processors) {
-        int total_turnaround_time = 0, total_waiting_time = 0;
-        int max_turnaround_time = 0, max_waiting_time = 0;
-        int total_processes = 0;
-
-        while (!processor.ready_queue.empty()) {
-            Process *process = processor.ready_queue.front();
-            processor.ready_queue.pop();
-
-            if (processor.current_time < process->arrival_time) {
-                processor.current_time = process->arrival_time;
-            }
-
-            process->waiting_time = processor.current_time - process->arrival_time;
-            for (int burst : process->cpu_bursts) {
-                processor.current_time += burst;
-            }
-            process->turnaround_time = processor.current_time - process->arrival_time;
-            process->completion_time = processor.current_time;
-
-            total_turnaround_time += process->turnaround_time;
-            total_waiting_time += process->waiting_time;
-            total_processes++;
-
-            if (process->turnaround_time > max_turnaround_time) {
-                max_turnaround_time = process->turnaround_time;
-            }
-            if (process->waiting_time > max_waiting_time) {
-                max_waiting_time = process->waiting_time;
-            }
-        }
-
-        // Compute the metrics for the current processor
-        int n = total_processes;
-        cout << "Processor " << processor_index << " - FIFO Metrics:" << endl;
-        cout << "Average Turnaround Time: " << (double)total_turnaround_time / n << endl;
-        cout << "Max Turnaround Time: " << max_turnaround_time << endl;
-        cout << "Average Waiting Time: " << (double)total_waiting_time / n << endl;
-        cout << "Max Waiting Time: " << max_waiting_time << endl;
-        cout << "Throughput: " << (double)n / (processor.current_time / 1e6) << " processes per second" << endl; // Processor throughput based on its current time
-        cout << "----------------------------------" << endl;
-
-        processor_index++;  // Move to the next processor index
+// Moves the processes assigned to a processor into an arrival-ordered list
+static vector<Process*> takeAssigned(Processor &processor) {
+    vector<Process*> assigned;
+    while (!processor.ready_queue.empty()) {
+        assigned.push_back(processor.ready_queue.front());
+        processor.ready_queue.pop();
     }
-
-    auto end_time = high_resolution_clock::now();
-    duration<double> elapsed_time = end_time - start_time;
-
-    // Overall simulation time
-    cout << "Overall FIFO Simulator Run Time: " << elapsed_time.count() << " seconds" << endl;
+    return assigned;
 }
 
-void runNonPreemptiveSJF(vector<Processor> &processors) {
-    int total_turnaround_time = 0, total_waiting_time = 0;
-    int max_turnaround_time = 0, max_waiting_time = 0;
-    int total_processes = 0;
-
-    auto start_time = chrono::steady_clock::now();
-
-    for (auto &processor : processors) {
-        auto &ready_queue = processor.ready_queue;
-        int &current_time = processor.current_time;
-
-        while (!ready_queue.empty()) {
-            vector<Process *> process_vector;
-
-            while (!ready_queue.empty()) {
-                process_vector.push_back(ready_queue.front());
-                ready_queue.pop();
-            }
-
-            sort(process_vector.begin(), process_vector.end(), [](Process *a, Process *b) {
-                return a->remaining_time < b->remaining_time;
-            });
-
-            for (auto process : process_vector) {
-                process->waiting_time = current_time - process->arrival_time;
-                current_time += process->remaining_time;
-                process->turnaround_time = current_time - process->arrival_time;
-                process->completion_time = current_time;
-
-                total_turnaround_time += process->turnaround_time;
-                total_waiting_time += process->waiting_time;
-
-                if (process->turnaround_time > max_turnaround_time) max_turnaround_time = process->turnaround_time;
-                if (process->waiting_time > max_waiting_time) max_waiting_time = process->waiting_time;
+// Traced runs always take the shared timeline, which is simulated on one thread
+static bool useSharedTimeline(const SimConfig &config, const SMPConfig &smp) {
+    return smp.sharedTimeline() || config.trace;
+}
 
-                total_processes++;
-            }
-        }
+// Runs FIFO over the processes assigned to a processor as a prefix scan when they are all a
+// single CPU burst and their times fit the scan; returns false otherwise
+static bool scanAssigned(const vector<Process*> &assigned, const SimConfig &config, int threads, Processor &processor,
+                         RunMetrics &metrics, SimCounters &counters) {
+    vector<int> arrival, burst, deadline;
+    arrival.reserve(assigned.size());
+    burst.reserve(assigned.size());
+    deadline.reserve(assigned.size());
+    for (const Process *process : assigned) {
+        if (process->burst_count != 1) return false;
+        arrival.push_back(process->arrival_time);
+        burst.push_back(process->cpuBurst(0));
+        deadline.push_back(process->deadline);
     }
-
-    auto end_time = chrono::steady_clock::now();
-    chrono::duration<double> elapsed_time = end_time - start_time;
-
-    cout << "Non-Preemptive SJF Average Turnaround Time: " << (double)total_turnaround_time / total_processes << endl;
-    cout << "Non-Preemptive SJF Max Turnaround Time: " << max_turnaround_time << endl;
-    cout << "Non-Preemptive SJF Average Waiting Time: " << (double)total_waiting_time / total_processes << endl;
-    cout << "Non-Preemptive SJF Max Waiting Time: " << max_waiting_time << endl;
-    cout << "Non-Preemptive SJF Throughput: " << (double)total_processes / elapsed_time.count() << " processes per second" << endl;
-    cout << "Non-Preemptive SJF Simulator Run Time: " << elapsed_time.count() << " seconds" << endl;
+    if (!scanFits(arrival.data(), burst.data(), assigned.size(), config.switching.context_switch)) return false;
+    FIFOScanResult result = scanFIFO(arrival.data(), burst.data(), deadline.data(), assigned.size(),
+                                     config.switching.context_switch, threads);
+    processor.current_time = result.last_completion;
+    metrics = result.metrics;
+    counters = result.counters;
+    return true;
 }
 
-void runPreemptiveSJF(vector<Processor> &processors) {
-    int total_turnaround_time = 0, total_waiting_time = 0;
-    int max_turnaround_time = 0, max_waiting_time = 0;
-    int total_processes = 0;
-
-    auto start_time = chrono::steady_clock::now();
-
-    for (auto &processor : processors) {
-        auto &ready_queue = processor.ready_queue;
-        int &current_time = processor.current_time;
-        vector<Process *> process_vector;
-
-        while (!ready_queue.empty() || !process_vector.empty()) {
-            while (!ready_queue.empty()) {
-                process_vector.push_back(ready_queue.front());
-                ready_queue.pop();
-            }
-
-            if (process_vector.empty()) {
-                current_time++;
-                continue;
-            }
-
-            auto shortest_process = min_element(process_vector.begin(), process_vector.end(),
-                                                [](Process *a, Process *b) { return a->remaining_time < b->remaining_time; });
-
-            Process *process = *shortest_process;
-            process->remaining_time--;
-            current_time++;
-
-            if (process->remaining_time == 0) {
-                process_vector.erase(shortest_process);
-                process->turnaround_time = current_time - process->arrival_time;
-                process->completion_time = current_time;
-                total_turnaround_time += process->turnaround_time;
-                total_waiting_time += (process->turnaround_time - accumulate(process->cpu_bursts.begin(), process->cpu_bursts.end(), 0));
+// Runs `simulate` on every processor, spread over up to one worker thread per hardware thread.
+// Processors never share processes or devices, so their timelines are independent and need no
+// synchronization. Metrics come back in processor order, which keeps merging them deterministic.
+template <typename Simulate>
+vector<RunMetrics> simulateProcessors(vector<Processor> &processors, Simulate simulate) {
+    vector<RunMetrics> metrics(processors.size());
+    atomic<size_t> next_processor(0);
+    auto work = [&]() {
+        for (size_t i = next_processor++; i < processors.size(); i = next_processor++) {
+            metrics[i] = simulate(processors[i]);
+        }
+    };
+
+    size_t workers = min<size_t>(processors.size(), max(1u, thread::hardware_concurrency()));
+    vector<thread> threads;
+    for (size_t i = 1; i < workers; i++) threads.emplace_back(work);
+    work();
+    for (auto &worker : threads) worker.join();
+    return metrics;
+}
 
-                if (process->turnaround_time > max_turnaround_time) max_turnaround_time = process->turnaround_time;
-                if ((process->turnaround_time - accumulate(process->cpu_bursts.begin(), process->cpu_bursts.end(), 0)) > max_waiting_time)
-                    max_waiting_time = (process->turnaround_time - accumulate(process->cpu_bursts.begin(), process->cpu_bursts.end(), 0));
+// Sums the metrics of all processors
+static RunMetrics mergeMetrics(const vector<RunMetrics> &per_processor) {
+    RunMetrics total;
+    for (const auto &metrics : per_processor) total.merge(metrics);
+    return total;
+}
 
-                total_processes++;
-            }
+// Simulates `Policy` on all processors: on one shared timeline when the cores interact or the
+// run is traced, otherwise each processor on its own timeline with the processes bound to it.
+// The counters of each processor go to `per_processor` and those of the whole run to `total`.
+template <typename Policy>
+vector<RunMetrics> simulatePolicy(vector<Processor> &processors, vector<Process> &processes, const SimConfig &config, const SMPConfig &smp,
+                                  vector<SimCounters> &per_processor, SimCounters &total) {
+    per_processor.assign(processors.size(), SimCounters());
+    if (useSharedTimeline(config, smp)) {
+        Simulator<Policy, MultiCore> simulator(config, MultiCore{smp});
+        ProcessArray<Process> arrivals(processes);
+        simulator.run(arrivals);
+        vector<RunMetrics> metrics;
+        for (size_t i = 0; i < processors.size(); i++) {
+            processors[i].current_time = simulator.lastCompletion(i);
+            metrics.push_back(simulator.metrics(i));
+            per_processor[i] = simulator.coreCounters(i);
         }
+        total = simulator.totalCounters();
+        return metrics;
     }
 
-    auto end_time = chrono::steady_clock::now();
-    chrono::duration<double> elapsed_time = end_time - start_time;
-
-    cout << "Preemptive SJF Average Turnaround Time: " << (double)total_turnaround_time / total_processes << endl;
-    cout << "Preemptive SJF Max Turnaround Time: " << max_turnaround_time << endl;
-    cout << "Preemptive SJF Average Waiting Time: " << (double)total_waiting_time / total_processes << endl;
-    cout << "Preemptive SJF Max Waiting Time: " << max_waiting_time << endl;
-    cout << "Preemptive SJF Throughput: " << (double)total_processes / elapsed_time.count() << " processes per second" << endl;
-    cout << "Preemptive SJF Simulator Run Time: " << elapsed_time.count() << " seconds" << endl;
+    // Each processor runs a loop of its own, so the total sums their loop times
+    vector<RunMetrics> metrics = simulateProcessors(processors, [&](Processor &processor) {
+        vector<Process*> assigned = takeAssigned(processor);
+        if constexpr (is_same<Policy, FIFOPolicy>::value) {
+            // The hardware threads not taken by other processors go to the scan
+            int threads = max<int>(1, thread::hardware_concurrency() / processors.size());
+            RunMetrics metrics;
+            if (scanAssigned(assigned, config, threads, processor, metrics, per_processor[processor.id])) return metrics;
+        }
+        ProcessArray<Process*> arrivals(assigned);
+        Simulator<Policy, UniCore> simulator(config, UniCore());
+        simulator.run(arrivals);
+        processor.current_time = simulator.lastCompletion(0);
+        per_processor[processor.id] = simulator.totalCounters();
+        return simulator.metrics(0);
+    });
+    total = SimCounters();
+    for (const auto &counters : per_processor) total.merge(counters);
+    return metrics;
 }
 
-void runCFS(vector<Processor> &processors) {
-    int total_turnaround_time = 0, total_waiting_time = 0;
-    int max_turnaround_time = 0, max_waiting_time = 0;
-    int total_processes = 0;
-
-    auto start_time = chrono::steady_clock::now();
-
-    for (auto &processor : processors) {
-        auto &ready_queue = processor.ready_queue;
-        int &current_time = processor.current_time;
-        map<int, Process*> cfs_tree;
-
-        while (!ready_queue.empty() || !cfs_tree.empty()) {
-            while (!ready_queue.empty()) {
-                Process *process = ready_queue.front();
-                cfs_tree[process->remaining_time] = process;
-                ready_queue.pop();
-            }
-
-            if (cfs_tree.empty()) {
-                current_time++;
-                continue;
-            }
-
-            auto first_process = cfs_tree.begin();
-            Process *process = first_process->second;
-            process->remaining_time--;
-            current_time++;
-
-            if (process->remaining_time == 0) {
-                cfs_tree.erase(first_process);
-                process->turnaround_time = current_time - process->arrival_time;
-                process->completion_time = current_time;
-                total_turnaround_time += process->turnaround_time;
-                total_waiting_time += (process->turnaround_time - accumulate(process->cpu_bursts.begin(), process->cpu_bursts.end(), 0));
-
-                if (process->turnaround_time > max_turnaround_time) max_turnaround_time = process->turnaround_time;
-                if ((process->turnaround_time - accumulate(process->cpu_bursts.begin(), process->cpu_bursts.end(), 0)) > max_waiting_time)
-                    max_waiting_time = (process->turnaround_time - accumulate(process->cpu_bursts.begin(), process->cpu_bursts.end(), 0));
-
-                total_processes++;
+// Runs the named algorithm and prints its metrics, separately for each processor for FIFO and
+// summed over all processors otherwise, and with `stats` ("text" or "json") its counters;
+// returns false for an unknown algorithm
+static bool runAlgorithm(const string &algorithm, vector<Processor> &processors, vector<Process> &processes,
+                         const SimConfig &config, const SMPConfig &smp, const string &stats, double parse_seconds) {
+    return visitPolicy(algorithm, [&](auto policy) {
+        using Policy = typename decltype(policy)::type;
+        auto start_time = steady_clock::now();
+        vector<SimCounters> counters;
+        SimCounters total;
+        vector<RunMetrics> per_processor = simulatePolicy<Policy>(processors, processes, config, smp, counters, total);
+        duration<double> elapsed_time = steady_clock::now() - start_time;
+
+        if (algorithm != "FIFO") {
+            printRunMetrics(Policy::NAME, mergeMetrics(per_processor), elapsed_time.count());
+            if (!stats.empty()) printStats(Policy::NAME, total, counters, parse_seconds, stats == "json");
+            return;
+        }
+        for (size_t processor_index = 0; processor_index < processors.size(); processor_index++) {
+            // Report the metrics of each processor
+            const RunMetrics &metrics = per_processor[processor_index];
+            long long n = metrics.total_processes;
+            cout << "Processor " << processor_index << " - FIFO Metrics:" << "\n";
+            cout << "Average Turnaround Time: " << (double)metrics.total_turnaround_time / n << "\n";
+            cout << "Max Turnaround Time: " << metrics.max_turnaround_time << "\n";
+            cout << "Average Waiting Time: " << (double)metrics.total_waiting_time / n << "\n";
+            cout << "Max Waiting Time: " << metrics.max_waiting_time << "\n";
+            printPercentiles("", metrics);
+            if (metrics.overhead_time > 0) {
+                cout << "Context Switches: " << metrics.context_switches << " (" << metrics.migrations
+                     << " migrations), Switching Overhead: " << metrics.overhead_time << "\n";
             }
+            cout << "Throughput: " << (double)n / (processors[processor_index].current_time / 1e6) << " processes per second" << "\n"; // Processor throughput based on its current time
+            cout << "----------------------------------" << "\n";
         }
-    }
-
-    auto end_time = chrono::steady_clock::now();
-    chrono::duration<double> elapsed_time = end_time - start_time;
-
-    cout << "CFS Average Turnaround Time: " << (double)total_turnaround_time / total_processes << endl;
-    cout << "CFS Max Turnaround Time: " << max_turnaround_time << endl;
-    cout << "CFS Average Waiting Time: " << (double)total_waiting_time / total_processes << endl;
-    cout << "CFS Max Waiting Time: " << max_waiting_time << endl;
-    cout << "CFS Throughput: " << (double)total_processes / elapsed_time.count() << " processes per second" << endl;
-    cout << "CFS Simulator Run Time: " << elapsed_time.count() << " seconds" << endl;
+        cout << "Overall FIFO Simulator Run Time: " << elapsed_time.count() << " seconds" << "\n";
+        if (!stats.empty()) printStats(Policy::NAME, total, counters, parse_seconds, stats == "json");
+    });
 }
 
 // Main function
 int main(int argc, char *argv[]) {
     if (argc < 3) {
-        cerr << "Usage: " << argv[0] << " <scheduling-algorithm> <path-to-workload-description-file>\n";
+        cerr << "Usage: " << argv[0] << " <scheduling-algorithm> <path-to-workload-description-file>"
+             << " [--cores N] [--placement static|least-loaded] [--work-stealing] [--balance-interval N]"
+             << " [--stats text|json] [--trace FILE] [--trace-events N] [--io-devices N] [--sched-latency N] [--min-granularity N] [--wakeup-granularity N]"
+             << " [--quantum N] [--mlfq-levels N] [--mlfq-quantum N] [--mlfq-boost N] [--eevdf-slice N]"
+             << " [--context-switch N] [--migration-cost N] [--cache-refill N] [--cache-half-life N]\n"
+             << "Processors are simulated on parallel threads only with static placement and without work stealing,"
+             << " balancing or a trace; otherwise all of them share one timeline on a single thread.\n";
         return 1;
     }
 
     string algorithm = argv[1];
     string file_path = argv[2];
 
-    vector<Process> processes = parseWorkloadFile(file_path);
+    // Optional settings follow the workload file as "--name value" pairs or bare flags
+    SimConfig config;
+    SMPConfig smp;
+    string trace_path, stats;
+    int trace_events = DEFAULT_TRACE_EVENTS;
+    for (int i = 3; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--work-stealing") {
+            smp.work_stealing = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Missing value for option: " << option << "\n";
+            return 1;
+        }
+        string text = argv[++i];
+        int value = atoi(text.c_str());
+        if (option == "--cores") {
+            smp.cores = value;
+        } else if (option == "--placement") {
+            if (text == "static") {
+                smp.placement = Placement::Static;
+            } else if (text == "least-loaded") {
+                smp.placement = Placement::LeastLoaded;
+            } else {
+                cerr << "Unknown placement policy: " << text << "\n";
+                return 1;
+            }
+        } else if (option == "--stats") {
+            stats = text;
+        } else if (option == "--trace") {
+            trace_path = text;
+        } else if (option == "--trace-events") {
+            trace_events = value;
+        } else if (option == "--balance-interval") {
+            smp.balance_interval = value;
+        } else if (option == "--io-devices") {
+            config.io_devices = value;
+        } else if (option == "--sched-latency") {
+            config.cfs.sched_latency = value;
+        } else if (option == "--min-granularity") {
+            config.cfs.min_granularity = value;
+        } else if (option == "--wakeup-granularity") {
+            config.cfs.wakeup_granularity = value;
+        } else if (option == "--quantum") {
+            config.rr_quantum = value;
+        } else if (option == "--mlfq-levels") {
+            config.mlfq.levels = value;
+        } else if (option == "--mlfq-quantum") {
+            config.mlfq.quantum = value;
+        } else if (option == "--mlfq-boost") {
+            config.mlfq.boost_interval = value;
+        } else if (option == "--eevdf-slice") {
+            config.eevdf_slice = value;
+        } else if (option == "--context-switch") {
+            config.switching.context_switch = value;
+        } else if (option == "--migration-cost") {
+            config.switching.migration = value;
+        } else if (option == "--cache-refill") {
+            config.switching.cache_refill = value;
+        } else if (option == "--cache-half-life") {
+            config.switching.cache_half_life = value;
+        } else {
+            cerr << "Unknown option: " << option << "\n";
+            return 1;
+        }
+    }
+    if (smp.cores < 1) {
+        cerr << "The number of cores must be at least 1\n";
+        return 1;
+    }
+    if (!stats.empty() && stats != "text" && stats != "json") {
+        cerr << "Unknown stats format: " << stats << "\n";
+        return 1;
+    }
+
+    // The trace rings are allocated before the run so recording never allocates
+    unique_ptr<Tracer> tracer;
+    if (!trace_path.empty()) {
+        tracer.reset(new Tracer(smp.cores, max(trace_events, 1)));
+        config.trace = tracer.get();
+    }
 
-    vector<Processor> processors(2); // Initialize two processors
+    auto parse_start = steady_clock::now();
+    Workload workload;
+    if (!parseWorkloadFile(file_path, workload)) {
+        cerr << "Could not open workload file: " << file_path << "\n";
+        return 1;
+    }
+    vector<Process> processes = makeProcesses(workload);
+    duration<double> parse_time = steady_clock::now() - parse_start;
+
+    vector<Processor> processors(smp.cores);
 
     // Initialize processors
-    for (int i = 0; i < 2; ++i) {
+    for (int i = 0; i < smp.cores; ++i) {
         processors[i].id = i;
         processors[i].current_time = 0;
     }
 
-    // Distribute processes between the two processors
-    for (auto &process : processes) {
-        int processor_id = process.id % 2;
-        processors[processor_id].ready_queue.push(&process);
+    // With static placement every process is bound to core id % cores up front
+    if (!useSharedTimeline(config, smp)) {
+        for (auto &process : processes) {
+            int processor_id = process.id % smp.cores;
+            processors[processor_id].ready_queue.push(&process);
+        }
     }
 
-    if (algorithm == "FIFO") {
-        runFIFO(processors);
-    } else if (algorithm == "SJF") {
-        runNonPreemptiveSJF(processors);
-    } else if (algorithm == "SJF-Preemptive") {
-        runPreemptiveSJF(processors);
-    } else if (algorithm == "CFS") {
-        runCFS(processors);
-    } else {
+    if (!runAlgorithm(algorithm, processors, processes, config, smp, stats, parse_time.count())) {
         cerr << "Unknown scheduling algorithm: " << algorithm << "\n";
         return 1;
     }
 
-    return 0;
+    return writeTrace(tracer.get(), trace_path);
 }
-
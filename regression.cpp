@@ -0,0 +1,223 @@
+#include "Scheduler.h"
+#include "Workload.h"
+#include "Simulator.h"
+#include "FIFOScan.h"
+#include "Generator.h"
+#include "SchedulerLibrary.h"
+
+using namespace std;
+
+// Regression checks for behavior that broke before. Each check prints what went wrong and
+// counts as a failure; the exit status is 1 if any check failed.
+
+static int failures = 0;
+
+static void check(bool ok, const string &what) {
+    if (ok) return;
+    cerr << "FAILED: " << what << "\n";
+    failures++;
+}
+
+static Workload parseText(const string &text) {
+    istringstream input(text);
+    return parseWorkloadStream(input);
+}
+
+// Metrics of FIFO simulated on one core
+static RunMetrics simulateFIFO(const Workload &workload, const SimConfig &config) {
+    vector<Process> processes = makeProcesses(workload);
+    ProcessArray<Process> arrivals(processes);
+    Simulator<FIFOPolicy, UniCore> simulator(config, UniCore());
+    simulator.run(arrivals);
+    return simulator.metrics(0);
+}
+
+static bool sameMetrics(const RunMetrics &a, const RunMetrics &b) {
+    return a.total_processes == b.total_processes && a.total_turnaround_time == b.total_turnaround_time &&
+           a.max_turnaround_time == b.max_turnaround_time && a.total_waiting_time == b.total_waiting_time &&
+           a.max_waiting_time == b.max_waiting_time && a.deadline_misses == b.deadline_misses;
+}
+
+// A process without bursts next to one with a CPU and an I/O burst has as many bursts as
+// processes, but is not a single-burst workload and must not be scanned
+static void checkFIFOScanMixedBursts() {
+    SimConfig config;
+    Workload mixed = parseText("0 -1\n1 5 3 -1\n");
+    check(!fifoScanApplies(mixed, config), "FIFO scan applies to a workload of 0 and 2 bursts");
+    RunMetrics simulated = simulateFIFO(mixed, config);
+    check(simulated.total_turnaround_time == 5 && simulated.max_turnaround_time == 5 && simulated.total_waiting_time == 0,
+          "FIFO over a workload of 0 and 2 bursts");
+
+    Workload single = parseText("0 5 -1\n1 3 -1 0 6\n2 4 -1\n");
+    check(fifoScanApplies(single, config), "FIFO scan does not apply to a single-burst workload");
+    check(sameMetrics(scanFIFO(single, config).metrics, simulateFIFO(single, config)),
+          "FIFO scan and simulation disagree on a single-burst workload");
+}
+
+// Completion, turnaround and waiting times are 32-bit lanes in the scan, so a workload whose
+// last completion is past INT_MAX once wrapped there and reported negative times. Such a
+// workload has to be simulated instead.
+static void checkFIFOScanSpan() {
+    SimConfig config;
+    Workload fits = parseText("0 2000000000 -1\n5 147483600 -1\n");
+    check(fifoScanApplies(fits, config), "FIFO scan does not apply to a workload ending just before INT_MAX");
+    check(sameMetrics(scanFIFO(fits, config).metrics, simulateFIFO(fits, config)),
+          "FIFO scan and simulation disagree on a workload ending just before INT_MAX");
+
+    Workload overflows = parseText("0 2000000000 -1\n1 2000000000 -1\n");
+    check(!fifoScanApplies(overflows, config), "FIFO scan applies to a workload ending past INT_MAX");
+    config.switching.context_switch = 100;
+    check(!fifoScanApplies(fits, config), "FIFO scan ignores the context switches when checking the span");
+}
+
+// Simulated time once was an int and wrapped on traces that run past INT_MAX. A process
+// that blocks across INT_MAX and one queued behind it must complete at their true times.
+static void checkTimePastIntMax() {
+    SimConfig config;
+    Workload workload = parseText("0 2000000000 2000000000 5 -1\n1 2000000000 -1\n");
+    vector<Process> processes = makeProcesses(workload);
+    ProcessArray<Process> arrivals(processes);
+    Simulator<FIFOPolicy, UniCore> simulator(config, UniCore());
+    simulator.run(arrivals);
+    check(simulator.lastCompletion(0) == 4000000005LL, "FIFO ends at the wrong time past INT_MAX");
+    const RunMetrics &metrics = simulator.metrics(0);
+    check(metrics.total_turnaround_time == 4000000005LL + 3999999999LL, "FIFO turnaround times wrap past INT_MAX");
+    check(metrics.max_turnaround_time == 4000000005LL && metrics.turnaround.percentile(100) == 4000000005LL,
+          "the turnaround maximum or histogram wraps past INT_MAX");
+
+    LatencyHistogram histogram;
+    histogram.record(LLONG_MAX);
+    check(histogram.percentile(50) == LLONG_MAX, "the latency histogram does not reach LLONG_MAX");
+}
+
+// With static placement the cores never interact, so simulating every core on a timeline of
+// its own must give the same metrics as one shared timeline. EEVDF once let a process that
+// was not eligible preempt on its deadline alone, which made the result depend on when the
+// shared timeline happened to check for preemption.
+static void checkStaticPlacementTimelines() {
+    GeneratorConfig generator;
+    generator.processes = 2000;
+    generator.arrival_rate = 0.2;
+    generator.cpu_bursts = 3;
+    generator.nice_spread = 10;
+    Workload workload;
+    check(generateWorkload(generator, workload, 1), "generating the static placement workload");
+
+    SimConfig config;
+    SMPConfig smp;
+    smp.cores = 4;
+    for (const string algorithm : {"FIFO", "SJF", "SJF-Preemptive", "CFS", "RR", "MLFQ", "EEVDF", "EDF"}) {
+        visitPolicy(algorithm, [&](auto policy) {
+            using Policy = typename decltype(policy)::type;
+            vector<Process> shared_processes = makeProcesses(workload);
+            ProcessArray<Process> shared_arrivals(shared_processes);
+            Simulator<Policy, MultiCore> shared(config, MultiCore{smp});
+            shared.run(shared_arrivals);
+
+            vector<Process> processes = makeProcesses(workload);
+            RunMetrics split;
+            for (int core = 0; core < smp.cores; core++) {
+                vector<Process*> assigned;
+                for (auto &process : processes) {
+                    if (process.id % smp.cores == core) assigned.push_back(&process);
+                }
+                ProcessArray<Process*> arrivals(assigned);
+                Simulator<Policy, UniCore> simulator(config, UniCore());
+                simulator.run(arrivals);
+                split.merge(simulator.metrics(0));
+            }
+            check(sameMetrics(shared.totalMetrics(), split),
+                  algorithm + " differs between shared and per-core timelines with static placement");
+        });
+    }
+}
+
+// The library runs a workload view through code of its own (a scan for single-burst FIFO,
+// reused process storage), so every policy must report through it what Simulator reports,
+// on one core and on several sharing a timeline
+static void checkLibraryMatchesSimulator() {
+    GeneratorConfig generator;
+    generator.processes = 2000;
+    generator.arrival_rate = 0.2;
+    generator.nice_spread = 10;
+    generator.deadline_slack = 3;
+    Workload single, mixed;
+    check(generateWorkload(generator, single, 1), "generating the single-burst library workload");
+    generator.cpu_bursts = 3;
+    check(generateWorkload(generator, mixed, 1), "generating the library workload");
+
+    SimConfig config;
+    SMPConfig smp;
+    smp.placement = Placement::LeastLoaded;
+    smp.work_stealing = true;
+    RunContext context;
+    for (const Workload *workload : {&single, &mixed}) {
+        for (int cores : {1, 4}) {
+            smp.cores = cores;
+            for (const string algorithm : {"FIFO", "SJF", "SJF-Preemptive", "CFS", "RR", "MLFQ", "EEVDF", "EDF"}) {
+                RunResult result;
+                check(context.run(workload->view(), algorithm, config, smp, result), "the library rejects " + algorithm);
+                visitPolicy(algorithm, [&](auto policy) {
+                    using Policy = typename decltype(policy)::type;
+                    vector<Process> processes = makeProcesses(*workload);
+                    ProcessArray<Process> arrivals(processes);
+                    RunMetrics metrics;
+                    long long makespan = 0;
+                    if (cores == 1) {
+                        Simulator<Policy, UniCore> simulator(config, UniCore());
+                        simulator.run(arrivals);
+                        metrics = simulator.totalMetrics();
+                        makespan = simulator.lastCompletion(0);
+                    } else {
+                        Simulator<Policy, MultiCore> simulator(config, MultiCore{smp});
+                        simulator.run(arrivals);
+                        metrics = simulator.totalMetrics();
+                        for (int i = 0; i < cores; i++) makespan = max(makespan, simulator.lastCompletion(i));
+                    }
+                    check(sameMetrics(result.metrics, metrics) && result.makespan == makespan,
+                          algorithm + " on " + to_string(cores) + " cores differs between the library and Simulator");
+                });
+            }
+        }
+    }
+}
+
+// Nice values outside the int8 column of the binary format once wrapped on conversion, so a
+// converted workload weighed its processes differently from its text source
+static void checkBinaryNiceRange() {
+    Workload text = parseText("0 5 -1 300\n1 5 -1 -200\n2 5 -1 -5\n");
+    string path = "/tmp/regression_nice_" + to_string(getpid()) + ".bin";
+    check(writeBinaryWorkload(text, path), "writing the nice range workload");
+    Workload binary;
+    check(parseWorkloadFile(path, binary), "reading the nice range workload back");
+    remove(path.c_str());
+    check(binary.size() == text.size(), "the nice range workload lost processes");
+    for (size_t i = 0; i < min(binary.size(), text.size()); i++) {
+        check(niceToWeight(binary.nice[i]) == niceToWeight(text.nice[i]),
+              "nice " + to_string(text.nice[i]) + " weighs differently after binary conversion");
+    }
+}
+
+// A workload file that could not be opened once parsed as an empty workload, so the programs
+// printed NaN averages and succeeded
+static void checkMissingWorkloadFile() {
+    Workload workload;
+    check(!parseWorkloadFile("/nonexistent/workload.dat", workload), "a missing workload file parses");
+    string path = "/tmp/regression_empty_" + to_string(getpid()) + ".dat";
+    ofstream(path).close();
+    check(parseWorkloadFile(path, workload) && workload.size() == 0, "an empty workload file does not parse");
+    remove(path.c_str());
+}
+
+int main() {
+    checkFIFOScanMixedBursts();
+    checkFIFOScanSpan();
+    checkTimePastIntMax();
+    checkBinaryNiceRange();
+    checkMissingWorkloadFile();
+    checkStaticPlacementTimelines();
+    checkLibraryMatchesSimulator();
+    if (failures > 0) return 1;
+    cout << "All regression checks passed\n";
+    return 0;
+}
@@ -0,0 +1,322 @@
+#include "Scheduler.h"
+#include "Workload.h"
+#include "Simulator.h"
+#include "ResultCache.h"
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+// One point of the sweep: a workload, an algorithm and the settings to run it with
+struct SweepRun {
+    int workload;
+    string algorithm;
+    SimConfig config;
+    SMPConfig smp;
+};
+
+// Aggregate metrics of one run
+struct SweepResult {
+    RunMetrics metrics;
+    long long makespan = 0;    // Time of the last completion on any core
+    double run_time = 0;       // Wall-clock seconds spent simulating
+    bool cached = false;       // Whether the result came from the result cache
+
+    SweepResult() = default;
+    explicit SweepResult(const CachedRun &run) : run_time(run.seconds) {
+        for (size_t i = 0; i < run.metrics.size(); i++) {
+            metrics.merge(run.metrics[i]);
+            makespan = max(makespan, run.last_completion[i]);
+        }
+    }
+};
+
+// Splits a comma-separated option value
+static vector<string> splitList(const string &text) {
+    vector<string> items;
+    stringstream stream(text);
+    string item;
+    while (getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+static vector<int> parseIntList(const string &text) {
+    vector<int> values;
+    for (const string &item : splitList(text)) values.push_back(atoi(item.c_str()));
+    return values;
+}
+
+static const char *placementName(Placement placement) {
+    return placement == Placement::LeastLoaded ? "least-loaded" : "static";
+}
+
+// Replaces every run by one copy per value, set on the copy by `apply`. A setting that only
+// the algorithm `only_for` reads is not varied for the others, which keep the first value.
+template <typename T, typename Apply>
+static vector<SweepRun> expand(const vector<SweepRun> &runs, const vector<T> &values, Apply apply, const char *only_for = nullptr) {
+    vector<SweepRun> expanded;
+    for (const SweepRun &run : runs) {
+        for (size_t i = 0; i < values.size(); i++) {
+            if (only_for && i > 0 && run.algorithm != only_for) break;
+            SweepRun copy = run;
+            apply(copy, values[i]);
+            expanded.push_back(copy);
+        }
+    }
+    return expanded;
+}
+
+// Runs one sweep point on fresh process state, refilled into the worker's `processes` so
+// consecutive runs reuse its memory; the workload itself is only read
+static CachedRun runSweepPoint(const SweepRun &run, const Workload &workload, vector<Process> &processes) {
+    makeProcesses(workload, processes);
+    ProcessArray<Process> arrivals(processes);
+    CachedRun result;
+
+    auto start_time = chrono::steady_clock::now();
+    visitPolicy(run.algorithm, [&](auto policy) {
+        Simulator<typename decltype(policy)::type, MultiCore> simulator(run.config, MultiCore{run.smp});
+        simulator.run(arrivals);
+        for (int i = 0; i < simulator.coreCount(); i++) {
+            result.metrics.push_back(simulator.metrics(i));
+            result.last_completion.push_back(simulator.lastCompletion(i));
+        }
+    });
+    auto end_time = chrono::steady_clock::now();
+
+    result.seconds = chrono::duration<double>(end_time - start_time).count();
+    return result;
+}
+
+// Runs the cross product of algorithms, workloads, core counts and scheduler settings. Every
+// workload is parsed once and shared read-only by all runs; each run builds its own process
+// state, and the runs are spread over a pool of worker threads. Results are printed as one
+// CSV table in sweep order. With --cache, runs found in the result cache are not simulated,
+// and workloads whose runs were all found are not even parsed.
+int main(int argc, char *argv[]) {
+    vector<string> algorithms = {"FIFO", "SJF", "SJF-Preemptive", "CFS", "RR", "MLFQ", "EEVDF", "EDF"};
+    vector<int> cores = {1};
+    vector<Placement> placements = {Placement::Static};
+    vector<int> work_stealing = {0};
+    vector<int> balance_intervals = {0};
+    vector<int> io_devices = {1};
+    vector<int> sched_latencies = {CFSParams().sched_latency};
+    vector<int> min_granularities = {CFSParams().min_granularity};
+    vector<int> wakeup_granularities = {CFSParams().wakeup_granularity};
+    vector<int> quanta = {SimConfig().rr_quantum};
+    vector<int> mlfq_levels = {MLFQParams().levels};
+    vector<int> mlfq_quanta = {MLFQParams().quantum};
+    vector<int> mlfq_boosts = {MLFQParams().boost_interval};
+    vector<int> eevdf_slices = {SimConfig().eevdf_slice};
+    vector<int> context_switches = {0};
+    vector<int> migration_costs = {0};
+    vector<int> cache_refills = {0};
+    vector<int> cache_half_lives = {0};
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    string cache_path;
+    long long cache_bytes = DEFAULT_CACHE_BYTES;
+    vector<string> workload_paths;
+
+    // Every option takes a comma-separated list; the remaining arguments are workload files
+    for (int i = 1; i < argc; i++) {
+        string option = argv[i];
+        if (option.compare(0, 2, "--") != 0) {
+            workload_paths.push_back(option);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Missing value for option: " << option << "\n";
+            return 1;
+        }
+        string text = argv[++i];
+        if (option == "--algorithms") {
+            algorithms = splitList(text);
+        } else if (option == "--cores") {
+            cores = parseIntList(text);
+        } else if (option == "--placement") {
+            placements.clear();
+            for (const string &name : splitList(text)) {
+                if (name == "static") {
+                    placements.push_back(Placement::Static);
+                } else if (name == "least-loaded") {
+                    placements.push_back(Placement::LeastLoaded);
+                } else {
+                    cerr << "Unknown placement policy: " << name << "\n";
+                    return 1;
+                }
+            }
+        } else if (option == "--work-stealing") {
+            work_stealing = parseIntList(text);
+        } else if (option == "--balance-interval") {
+            balance_intervals = parseIntList(text);
+        } else if (option == "--io-devices") {
+            io_devices = parseIntList(text);
+        } else if (option == "--sched-latency") {
+            sched_latencies = parseIntList(text);
+        } else if (option == "--min-granularity") {
+            min_granularities = parseIntList(text);
+        } else if (option == "--wakeup-granularity") {
+            wakeup_granularities = parseIntList(text);
+        } else if (option == "--quantum") {
+            quanta = parseIntList(text);
+        } else if (option == "--mlfq-levels") {
+            mlfq_levels = parseIntList(text);
+        } else if (option == "--mlfq-quantum") {
+            mlfq_quanta = parseIntList(text);
+        } else if (option == "--mlfq-boost") {
+            mlfq_boosts = parseIntList(text);
+        } else if (option == "--eevdf-slice") {
+            eevdf_slices = parseIntList(text);
+        } else if (option == "--context-switch") {
+            context_switches = parseIntList(text);
+        } else if (option == "--migration-cost") {
+            migration_costs = parseIntList(text);
+        } else if (option == "--cache-refill") {
+            cache_refills = parseIntList(text);
+        } else if (option == "--cache-half-life") {
+            cache_half_lives = parseIntList(text);
+        } else if (option == "--threads") {
+            threads = max(1, atoi(text.c_str()));
+        } else if (option == "--cache") {
+            cache_path = text;
+        } else if (option == "--cache-size") {
+            cache_bytes = atoll(text.c_str()) << 20;
+        } else {
+            cerr << "Unknown option: " << option << "\n";
+            return 1;
+        }
+    }
+
+    if (workload_paths.empty()) {
+        cerr << "Usage: " << argv[0] << " [--algorithms A,B,...] [--cores N,...] [--placement P,...]"
+             << " [--work-stealing 0,1] [--balance-interval N,...] [--io-devices N,...] [--sched-latency N,...]"
+             << " [--min-granularity N,...] [--wakeup-granularity N,...] [--quantum N,...] [--mlfq-levels N,...]"
+             << " [--mlfq-quantum N,...] [--mlfq-boost N,...] [--eevdf-slice N,...] [--context-switch N,...]"
+             << " [--migration-cost N,...] [--cache-refill N,...] [--cache-half-life N,...] [--threads N]"
+             << " [--cache DIR] [--cache-size MB] <workload-file>...\n";
+        return 1;
+    }
+    for (const string &algorithm : algorithms) {
+        if (!visitPolicy(algorithm, [](auto) {})) {
+            cerr << "Unknown scheduling algorithm: " << algorithm << "\n";
+            return 1;
+        }
+    }
+    for (int core_count : cores) {
+        if (core_count < 1) {
+            cerr << "The number of cores must be at least 1\n";
+            return 1;
+        }
+    }
+
+    unique_ptr<ResultCache> cache;
+    if (!cache_path.empty()) {
+        cache.reset(new ResultCache(cache_path, cache_bytes));
+        if (!cache->opened()) {
+            cerr << "Could not open cache directory: " << cache_path << "\n";
+            return 1;
+        }
+    }
+
+    vector<SweepRun> runs;
+    for (size_t w = 0; w < workload_paths.size(); w++) {
+        SweepRun run;
+        run.workload = w;
+        runs.push_back(run);
+    }
+    runs = expand(runs, algorithms, [](SweepRun &run, const string &value) { run.algorithm = value; });
+    runs = expand(runs, cores, [](SweepRun &run, int value) { run.smp.cores = value; });
+    runs = expand(runs, placements, [](SweepRun &run, Placement value) { run.smp.placement = value; });
+    runs = expand(runs, work_stealing, [](SweepRun &run, int value) { run.smp.work_stealing = value != 0; });
+    runs = expand(runs, balance_intervals, [](SweepRun &run, int value) { run.smp.balance_interval = value; });
+    runs = expand(runs, io_devices, [](SweepRun &run, int value) { run.config.io_devices = value; });
+    runs = expand(runs, context_switches, [](SweepRun &run, int value) { run.config.switching.context_switch = value; });
+    runs = expand(runs, migration_costs, [](SweepRun &run, int value) { run.config.switching.migration = value; });
+    runs = expand(runs, cache_refills, [](SweepRun &run, int value) { run.config.switching.cache_refill = value; });
+    runs = expand(runs, cache_half_lives, [](SweepRun &run, int value) { run.config.switching.cache_half_life = value; });
+    runs = expand(runs, sched_latencies, [](SweepRun &run, int value) { run.config.cfs.sched_latency = value; }, "CFS");
+    runs = expand(runs, min_granularities, [](SweepRun &run, int value) { run.config.cfs.min_granularity = value; }, "CFS");
+    runs = expand(runs, wakeup_granularities, [](SweepRun &run, int value) { run.config.cfs.wakeup_granularity = value; }, "CFS");
+    runs = expand(runs, quanta, [](SweepRun &run, int value) { run.config.rr_quantum = value; }, "RR");
+    runs = expand(runs, mlfq_levels, [](SweepRun &run, int value) { run.config.mlfq.levels = value; }, "MLFQ");
+    runs = expand(runs, mlfq_quanta, [](SweepRun &run, int value) { run.config.mlfq.quantum = value; }, "MLFQ");
+    runs = expand(runs, mlfq_boosts, [](SweepRun &run, int value) { run.config.mlfq.boost_interval = value; }, "MLFQ");
+    runs = expand(runs, eevdf_slices, [](SweepRun &run, int value) { run.config.eevdf_slice = value; }, "EEVDF");
+
+    // Runs of workloads that cannot be mapped have no description and are never cached
+    vector<SweepResult> results(runs.size());
+    vector<string> descriptions(runs.size());
+    if (cache) {
+        vector<ContentHash> hashes(workload_paths.size());
+        vector<char> hashed(workload_paths.size());
+        for (size_t w = 0; w < workload_paths.size(); w++) hashed[w] = hashWorkloadFile(workload_paths[w], hashes[w]);
+        for (size_t i = 0; i < runs.size(); i++) {
+            if (!hashed[runs[i].workload]) continue;
+            descriptions[i] = describeRun(hashes[runs[i].workload], "MultiCore", runs[i].algorithm, runs[i].config, runs[i].smp);
+            CachedRun run;
+            if (cache->lookup(descriptions[i], run)) {
+                results[i] = SweepResult(run);
+                results[i].cached = true;
+            }
+        }
+    }
+
+    vector<Workload> workloads(workload_paths.size());
+    vector<char> needed(workload_paths.size());
+    for (size_t i = 0; i < runs.size(); i++) needed[runs[i].workload] |= !results[i].cached;
+    for (size_t w = 0; w < workload_paths.size(); w++) {
+        if (needed[w] && !parseWorkloadFile(workload_paths[w], workloads[w])) {
+            cerr << "Could not open workload file: " << workload_paths[w] << "\n";
+            return 1;
+        }
+    }
+
+    atomic<size_t> next_run(0);
+    atomic<bool> cache_failed(false);
+    auto work = [&]() {
+        vector<Process> processes;
+        for (size_t i = next_run++; i < runs.size(); i = next_run++) {
+            if (results[i].cached) continue;
+            CachedRun run = runSweepPoint(runs[i], workloads[runs[i].workload], processes);
+            results[i] = SweepResult(run);
+            if (cache && !descriptions[i].empty() && !cache->store(descriptions[i], run)) cache_failed = true;
+        }
+    };
+    vector<thread> workers;
+    for (unsigned i = 1; i < min<size_t>(threads, runs.size()); i++) workers.emplace_back(work);
+    work();
+    for (auto &worker : workers) worker.join();
+    if (cache_failed) cerr << "Could not write to cache directory: " << cache_path << "\n";
+
+    cout << "workload,algorithm,cores,placement,work_stealing,balance_interval,io_devices,"
+         << "sched_latency,min_granularity,wakeup_granularity,quantum,mlfq_levels,mlfq_quantum,mlfq_boost,"
+         << "eevdf_slice,context_switch,migration_cost,cache_refill,cache_half_life,processes,avg_turnaround_time,max_turnaround_time,p50_turnaround_time,"
+         << "p99_turnaround_time,avg_waiting_time,max_waiting_time,p50_waiting_time,p99_waiting_time,"
+         << "avg_response_time,p99_response_time,deadline_misses,context_switches,migrations,overhead_time,"
+         << "makespan,run_time" << endl;
+    for (size_t i = 0; i < runs.size(); i++) {
+        const SweepRun &run = runs[i];
+        const RunMetrics &metrics = results[i].metrics;
+        long long n = metrics.total_processes;
+        cout << workload_paths[run.workload] << "," << run.algorithm << "," << run.smp.cores << ","
+             << placementName(run.smp.placement) << "," << run.smp.work_stealing << ","
+             << run.smp.balance_interval << "," << run.config.io_devices << ","
+             << run.config.cfs.sched_latency << "," << run.config.cfs.min_granularity << ","
+             << run.config.cfs.wakeup_granularity << "," << run.config.rr_quantum << ","
+             << run.config.mlfq.levels << "," << run.config.mlfq.quantum << "," << run.config.mlfq.boost_interval << ","
+             << run.config.eevdf_slice << "," << run.config.switching.context_switch << ","
+             << run.config.switching.migration << "," << run.config.switching.cache_refill << ","
+             << run.config.switching.cache_half_life << "," << n << ","
+             << (double)metrics.total_turnaround_time / n << "," << metrics.max_turnaround_time << ","
+             << metrics.turnaround.percentile(50) << "," << metrics.turnaround.percentile(99) << ","
+             << (double)metrics.total_waiting_time / n << "," << metrics.max_waiting_time << ","
+             << metrics.waiting.percentile(50) << "," << metrics.waiting.percentile(99) << ","
+             << (double)metrics.total_response_time / n << "," << metrics.response.percentile(99) << ","
+             << metrics.deadline_misses << "," << metrics.context_switches << "," << metrics.migrations << ","
+             << metrics.overhead_time << "," << results[i].makespan << "," << results[i].run_time << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "Trace.h"
+#include <cstdio>
+
+using namespace std;
+
+static const char *endName(TraceEventType type) {
+    switch (type) {
+    case TraceEventType::Preempt: return "preempt";
+    case TraceEventType::Block: return "block";
+    default: return "complete";
+    }
+}
+
+// Converts a binary scheduling trace into Chrome trace-event JSON for Perfetto or
+// chrome://tracing. Every core is a thread track: a process's time on the core is a slice from
+// its dispatch until it is preempted, blocks or completes, and wake-ups are instant events.
+// One simulated time unit is shown as one microsecond.
+int main(int argc, char *argv[]) {
+    if (argc != 2 && argc != 3) {
+        cerr << "Usage: " << argv[0] << " <path-to-trace> [path-to-json]\n";
+        return 1;
+    }
+
+    ifstream in(argv[1], ios::binary);
+    TraceHeader header;
+    if (!in.read((char *)&header, sizeof(header)) || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TRACE_VERSION) {
+        cerr << "Not a scheduling trace: " << argv[1] << "\n";
+        return 1;
+    }
+
+    FILE *out = argc == 3 ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        cerr << "Could not open output file: " << argv[2] << "\n";
+        return 1;
+    }
+
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(out, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"Scheduler\"}}");
+    for (uint32_t core = 0; core < header.cores; core++) {
+        uint64_t counts[2];
+        if (!in.read((char *)counts, sizeof(counts))) {
+            cerr << "Truncated trace: " << argv[1] << "\n";
+            return 1;
+        }
+        if (counts[0] > 0) cerr << "Core " << core << ": the first " << counts[0] << " events were overwritten\n";
+        fprintf(out, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %u, \"args\": {\"name\": \"Core %u\"}}",
+                core, core);
+
+        // Process on the core and the time it was dispatched; none until the first dispatch,
+        // since the events before it may have been overwritten
+        int running = -1;
+        long long since = 0;
+        for (uint64_t i = 0; i < counts[1]; i++) {
+            TraceEvent event;
+            if (!in.read((char *)&event, sizeof(event))) {
+                cerr << "Truncated trace: " << argv[1] << "\n";
+                return 1;
+            }
+            if (event.type == TraceEventType::Dispatch) {
+                running = event.process;
+                since = event.time;
+            } else if (event.type == TraceEventType::Wake) {
+                fprintf(out, ",\n{\"name\": \"wake P%d\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %lld, \"pid\": 0, \"tid\": %u}",
+                        event.process, (long long)event.time, core);
+            } else if (event.process == running) {
+                fprintf(out, ",\n{\"name\": \"P%d\", \"ph\": \"X\", \"ts\": %lld, \"dur\": %lld, \"pid\": 0, \"tid\": %u, "
+                        "\"args\": {\"end\": \"%s\"}}", running, since, event.time - since, core, endName(event.type));
+                running = -1;
+            }
+        }
+    }
+    fprintf(out, "\n]}\n");
+
+    bool ok = !ferror(out);
+    if (out != stdout) ok = fclose(out) == 0 && ok;
+    if (!ok) {
+        cerr << "Could not write output file\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "Scheduler.h"
+#include "Workload.h"
+#include "Simulator.h"
+#include <chrono>
+
+using namespace std;
+using namespace std::chrono;
+
+// Checkpoints taken over the span of the base workload when no interval is given
+const int DEFAULT_CHECKPOINTS = 64;
+
+// Index of the first process that differs between two arrival-sorted workloads
+static size_t firstDifference(const Workload &a, const Workload &b) {
+    size_t n = min(a.size(), b.size());
+    for (size_t i = 0; i < n; i++) {
+        if (a.id[i] != b.id[i] || a.arrival_time[i] != b.arrival_time[i] || a.nice[i] != b.nice[i] ||
+            a.deadline[i] != b.deadline[i] ||
+            !equal(a.bursts.begin() + a.burst_offset[i], a.bursts.begin() + a.burst_offset[i + 1],
+                   b.bursts.begin() + b.burst_offset[i], b.bursts.begin() + b.burst_offset[i + 1])) {
+            return i;
+        }
+    }
+    return n;
+}
+
+// What-if analysis: simulates a base workload once, saving checkpoints as it goes, then
+// answers every variant of it by resuming from the latest checkpoint before the first process
+// that differs. Variants that only change late arrivals re-simulate only the end of the run,
+// and their metrics are exactly those of a full run.
+int main(int argc, char *argv[]) {
+    SimConfig config;
+    int checkpoint_interval = 0;
+    vector<string> positional;
+
+    // Options are "--name value" pairs anywhere on the line; the other arguments are the
+    // algorithm and the workload files
+    for (int i = 1; i < argc; i++) {
+        string option = argv[i];
+        if (option.compare(0, 2, "--") != 0) {
+            positional.push_back(option);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Missing value for option: " << option << "\n";
+            return 1;
+        }
+        int value = atoi(argv[++i]);
+        if (option == "--checkpoint-interval") {
+            checkpoint_interval = value;
+        } else if (option == "--io-devices") {
+            config.io_devices = value;
+        } else if (option == "--sched-latency") {
+            config.cfs.sched_latency = value;
+        } else if (option == "--min-granularity") {
+            config.cfs.min_granularity = value;
+        } else if (option == "--wakeup-granularity") {
+            config.cfs.wakeup_granularity = value;
+        } else if (option == "--quantum") {
+            config.rr_quantum = value;
+        } else if (option == "--mlfq-levels") {
+            config.mlfq.levels = value;
+        } else if (option == "--mlfq-quantum") {
+            config.mlfq.quantum = value;
+        } else if (option == "--mlfq-boost") {
+            config.mlfq.boost_interval = value;
+        } else if (option == "--eevdf-slice") {
+            config.eevdf_slice = value;
+        } else if (option == "--context-switch") {
+            config.switching.context_switch = value;
+        } else if (option == "--migration-cost") {
+            config.switching.migration = value;
+        } else if (option == "--cache-refill") {
+            config.switching.cache_refill = value;
+        } else if (option == "--cache-half-life") {
+            config.switching.cache_half_life = value;
+        } else {
+            cerr << "Unknown option: " << option << "\n";
+            return 1;
+        }
+    }
+
+    if (positional.size() < 3) {
+        cerr << "Usage: " << argv[0] << " <scheduling-algorithm> <base-workload> <variant-workload>..."
+             << " [--checkpoint-interval N] [--io-devices N] [--sched-latency N] [--min-granularity N]"
+             << " [--wakeup-granularity N] [--quantum N] [--mlfq-levels N] [--mlfq-quantum N] [--mlfq-boost N]"
+             << " [--eevdf-slice N] [--context-switch N] [--migration-cost N] [--cache-refill N] [--cache-half-life N]\n";
+        return 1;
+    }
+    string algorithm = positional[0];
+
+    Workload base;
+    vector<Workload> variants(positional.size() - 2);
+    for (size_t i = 1; i < positional.size(); i++) {
+        if (!parseWorkloadFile(positional[i], i == 1 ? base : variants[i - 2])) {
+            cerr << "Could not open workload file: " << positional[i] << "\n";
+            return 1;
+        }
+    }
+    if (checkpoint_interval <= 0) {
+        int span = base.size() > 0 ? base.arrival_time.back() : 0;
+        checkpoint_interval = max(span / DEFAULT_CHECKPOINTS, 1);
+    }
+
+    // Checkpoints point into the process storage, so it is sized up front for every variant
+    // and never reallocated
+    size_t capacity = base.size();
+    for (const Workload &variant : variants) capacity = max(capacity, variant.size());
+    vector<Process> processes;
+    processes.reserve(capacity);
+    for (size_t i = 0; i < base.size(); i++) processes.emplace_back(base, i);
+
+    bool known = visitPolicy(algorithm, [&](auto policy) {
+        using Policy = typename decltype(policy)::type;
+        auto start_time = steady_clock::now();
+        Simulator<Policy, UniCore> base_run(config, UniCore());
+        base_run.enableCheckpoints(checkpoint_interval);
+        ProcessArray<Process> arrivals(processes);
+        base_run.run(arrivals);
+        duration<double> elapsed_time = steady_clock::now() - start_time;
+        cout << "== " << positional[1] << ": full run, " << base_run.checkpoints().size() << " checkpoints" << endl;
+        printRunMetrics(Policy::NAME, base_run.metrics(0), elapsed_time.count());
+
+        for (size_t v = 0; v < variants.size(); v++) {
+            const Workload &variant = variants[v];
+            size_t first = firstDifference(base, variant);
+            int changed_from = min(first < base.size() ? base.arrival_time[first] : INT_MAX,
+                                   first < variant.size() ? variant.arrival_time[first] : INT_MAX);
+
+            start_time = steady_clock::now();
+            const Checkpoint<Policy> *checkpoint = base_run.checkpointBefore(changed_from);
+            // Everything not yet admitted at the checkpoint starts afresh from the variant
+            size_t kept = checkpoint ? checkpoint->next_arrival : 0;
+            processes.erase(processes.begin() + kept, processes.end());
+            for (size_t i = kept; i < variant.size(); i++) processes.emplace_back(variant, i);
+
+            Simulator<Policy, UniCore> variant_run(config, UniCore());
+            if (checkpoint) {
+                variant_run.resume(*checkpoint, processes);
+            } else {
+                ProcessArray<Process> variant_arrivals(processes);
+                variant_run.run(variant_arrivals);
+            }
+            elapsed_time = steady_clock::now() - start_time;
+
+            cout << "== " << positional[v + 2] << ": resumed at time " << (checkpoint ? checkpoint->time : 0)
+                 << " with " << variant.size() - kept << " of " << variant.size() << " processes still to arrive" << endl;
+            printRunMetrics(Policy::NAME, variant_run.metrics(0), elapsed_time.count());
+        }
+    });
+    if (!known) {
+        cerr << "Unknown scheduling algorithm: " << algorithm << "\n";
+        return 1;
+    }
+    return 0;
+}